@@ -6,6 +6,10 @@
 
 */
 
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 #include "arg.h"
@@ -18,12 +22,19 @@ using namespace potoroo;
 
 namespace
 {
-    inline bool argProc_cond(const ArgList& args, int n)
+    //! @brief Checks the number of arguments, not counting the ones which only affect how the jobfile is processed
+    inline bool argProc_cond(const ArgList& args, size_t n)
     {
-        return (
-            (args.count() == n) ||
-            ((args.count() == (n + 1)) && args.contains(ArgType::forceJf))
-            );
+        if (args.contains(ArgType::forceJf)) ++n;
+        if (args.contains(ArgType::jobs)) ++n;
+        if (args.contains(ArgType::incremental)) ++n;
+        if (args.contains(ArgType::incrementalHash)) ++n;
+        if (args.contains(ArgType::watch)) ++n;
+        if (args.contains(ArgType::stats)) ++n;
+        if (args.contains(ArgType::trace)) ++n;
+        if (args.contains(ArgType::diag)) ++n;
+
+        return (args.count() == n);
     }
 
     inline bool argProcJF_cond_in(const ArgList& args)
@@ -59,6 +70,62 @@ namespace
             ++err;
         }
 
+        if (args.count(ArgType::jobs) != 0)
+        {
+            if (err) errMsg += ", ";
+            errMsg += argStr_jobs + " not supported inside a jobfile";
+            ++err;
+        }
+        else if (args.count(ArgType::incremental) != 0)
+        {
+            if (err) errMsg += ", ";
+            errMsg += argStr_incremental + " not supported inside a jobfile";
+            ++err;
+        }
+        else if (args.count(ArgType::incrementalHash) != 0)
+        {
+            if (err) errMsg += ", ";
+            errMsg += argStr_incrementalHash + " not supported inside a jobfile";
+            ++err;
+        }
+        else if (args.count(ArgType::watch) != 0)
+        {
+            if (err) errMsg += ", ";
+            errMsg += argStr_watch + " not supported inside a jobfile";
+            ++err;
+        }
+        else if (args.count(ArgType::serve) != 0)
+        {
+            if (err) errMsg += ", ";
+            errMsg += argStr_serve + " not supported inside a jobfile";
+            ++err;
+        }
+        else if (args.count(ArgType::connect) != 0)
+        {
+            if (err) errMsg += ", ";
+            errMsg += argStr_connect + " not supported inside a jobfile";
+            ++err;
+        }
+        else if (args.count(ArgType::stats) != 0)
+        {
+            if (err) errMsg += ", ";
+            errMsg += argStr_stats + " not supported inside a jobfile";
+            ++err;
+        }
+        else if (args.count(ArgType::trace) != 0)
+        {
+            if (err) errMsg += ", ";
+            errMsg += argStr_trace + " not supported inside a jobfile";
+            ++err;
+        }
+        else if (args.count(ArgType::diag) != 0)
+        {
+            if (err) errMsg += ", ";
+            errMsg += argStr_diag + " not supported inside a jobfile";
+            ++err;
+        }
+        else cond |= (1 << 3);
+
         if (!args.containsInvalid()) cond |= (1 << 1);
         else
         {
@@ -67,9 +134,7 @@ namespace
             ++err;
         }
 
-        if (((args.count(ArgType::copy) == 0) && (args.count(ArgType::copyow) == 0)) ||
-            ((args.count(ArgType::copy) == 0) && (args.count(ArgType::copyow) == 1)) ||
-            ((args.count(ArgType::copy) == 1) && (args.count(ArgType::copyow) == 0)))
+        if ((args.count(ArgType::copy) + args.count(ArgType::copyow) + args.count(ArgType::copycmp)) <= 1)
         {
             cond |= (1 << 2);
         }
@@ -80,7 +145,7 @@ namespace
             ++err;
         }
 
-        return (cond == 0x07);
+        return (cond == 0x0F);
     }
 }
 
@@ -101,11 +166,27 @@ potoroo::Arg::Arg(const std::string& arg)
     else if (arg == argStr_od) type = ArgType::outDir;
     else if (arg == argStr_tag) type = ArgType::tag;
     else if (arg == argStr_forceJf) type = ArgType::forceJf;
+    else if (arg == argStr_jobs) type = ArgType::jobs;
+    else if (arg == argStr_incremental) type = ArgType::incremental;
+    else if (arg == argStr_incrementalHash) type = ArgType::incrementalHash;
+    else if (arg == argStr_watch) type = ArgType::watch;
+    else if (arg == argStr_serve) type = ArgType::serve;
+    else if (arg == argStr_connect) type = ArgType::connect;
+    else if (arg == argStr_stats) type = ArgType::stats;
+    else if (arg == argStr_trace) type = ArgType::trace;
+    else if (arg == argStr_diag) type = ArgType::diag;
+    else if (arg == argStr_statsJson)
+    {
+        type = ArgType::stats;
+        value = "json";
+    }
     else if (arg == argStr_wError) type = ArgType::wError;
     else if (arg == argStr_wSup) type = ArgType::wSup;
     else if (arg == argStr_copy) type = ArgType::copy;
     else if (arg == argStr_copyow) type = ArgType::copyow;
+    else if (arg == argStr_copycmp) type = ArgType::copycmp;
     else if (arg == argStr_wrErrLn) type = ArgType::wrErrLn;
+    else if (arg == argStr_wrIfChanged) type = ArgType::wrIfChanged;
     else if ((arg == argStr_help) || (arg == argStr_help_alt)) type = ArgType::help;
     else if ((arg == argStr_version) || (arg == argStr_version_alt)) type = ArgType::version;
     else type = ArgType::argType_invalid;
@@ -119,7 +200,7 @@ ArgType potoroo::Arg::getType() const
     return type;
 }
 
-std::string potoroo::Arg::getValue() const
+const std::string& potoroo::Arg::getValue() const
 {
     return value;
 }
@@ -141,7 +222,13 @@ bool potoroo::Arg::hasValue() const
     if ((type == ArgType::wError) ||
         (type == ArgType::copy) ||
         (type == ArgType::copyow) ||
+        (type == ArgType::copycmp) ||
+        (type == ArgType::wrIfChanged) ||
         (type == ArgType::forceJf) ||
+        (type == ArgType::incremental) ||
+        (type == ArgType::incrementalHash) ||
+        (type == ArgType::watch) ||
+        (type == ArgType::stats) ||
         (type == ArgType::help) ||
         (type == ArgType::version))
     {
@@ -165,6 +252,15 @@ std::string potoroo::Arg::dbgType() const
     else if (type == ArgType::outDir) return "outDir";
     else if (type == ArgType::tag) return "tag";
     else if (type == ArgType::forceJf) return argStr_forceJf;
+    else if (type == ArgType::jobs) return "jobs";
+    else if (type == ArgType::incremental) return argStr_incremental;
+    else if (type == ArgType::incrementalHash) return argStr_incrementalHash;
+    else if (type == ArgType::watch) return argStr_watch;
+    else if (type == ArgType::serve) return argStr_serve;
+    else if (type == ArgType::connect) return argStr_connect;
+    else if (type == ArgType::stats) return argStr_stats;
+    else if (type == ArgType::trace) return argStr_trace;
+    else if (type == ArgType::diag) return argStr_diag;
     else if (type == ArgType::wError) return "wError";
     else if (type == ArgType::wSup) return "wSup";
     else if (type == ArgType::help) return "help";
@@ -210,14 +306,17 @@ bool potoroo::ArgList::containsInvalid() const
     return false;
 }
 
-Arg potoroo::ArgList::get(ArgType at) const
+//! @brief The first argument of the type, an invalid argument if there is none
+const Arg& potoroo::ArgList::get(ArgType at) const
 {
+    static const Arg none;
+
     for (size_t i = 0; i < args.size(); ++i)
     {
         if (args[i].getType() == at) return args[i];
     }
 
-    return Arg();
+    return none;
 }
 
 size_t potoroo::ArgList::count() const
@@ -372,41 +471,83 @@ ArgList potoroo::ArgList::parse(const char* args)
 
 
 
+//! @brief Parses the comma separated list of the -Wsup argument
+//! @param [out] list Only written on success
+//! @param strList
+//! @return 0 on success
+//!
+//! The IDs are parsed like std::stoi(), the characters which follow the number are ignored.
+//!
 int potoroo::wSupStrListToVector(std::vector<int>& list, const std::string& strList)
 {
     const char* p = strList.c_str();
     const char* const pMax = p + strList.length();
 
-    vector<string> tmpStrList;
+    vector<int> tmpList;
+
+    if (p < pMax)
+    {
+        size_t n = 1;
+        for (const char* c = p; (c = static_cast<const char*>(memchr(c, ',', pMax - c))) != nullptr; ++c) ++n;
+        tmpList.reserve(n);
+    }
 
     while (p < pMax)
     {
-        string tmpStr = "";
-        while ((p < pMax) && (*p != ','))
-        {
-            tmpStr += *p;
-            ++p;
-        }
+        // strtol() does not skip commas, so it does not read beyond the ID
+        char* end;
+        errno = 0;
+        const long value = strtol(p, &end, 10);
+
+        if ((end == p) || (errno == ERANGE) || (value < INT_MIN) || (value > INT_MAX)) return 1;
+
+        tmpList.push_back(static_cast<int>(value));
+
+        p = static_cast<const char*>(memchr(end, ',', pMax - end));
+        if (!p) break;
         ++p; // skip the comma
-        tmpStrList.push_back(tmpStr);
     }
 
-    vector<int> tmpList;
-    int r = 0;
+    list.swap(tmpList);
 
-    for (size_t i = 0; i < tmpStrList.size(); ++i)
-    {
-        try { tmpList.push_back(std::stoi(tmpStrList[i])); }
-        catch (...)
-        {
-            r = 1;
-            break;
-        }
-    }
+    return 0;
+}
+
+
+
+//! @brief Parses the value of the -j argument
+//! @param [out] n Number of jobs to run in parallel, only written on success
+//! @param str
+//! @return 0 on success
+int potoroo::jobsStrToCount(size_t& n, const std::string& str)
+{
+    if ((str.length() == 0) || (str.find_first_not_of("0123456789") != string::npos)) return 1;
+
+    unsigned long value;
 
-    if (r == 0) list = vector<int>(tmpList);
+    try { value = std::stoul(str); }
+    catch (...) { return 1; }
 
-    return r;
+    if (value == 0) return 1;
+
+    n = static_cast<size_t>(value);
+
+    return 0;
+}
+
+//! @brief Parses the value of the --diag argument
+//! @param [out] format Only written on success
+//! @param str "text", "json", "sarif" or "quiet"
+//! @return 0 on success
+int potoroo::diagStrToFormat(EwiFormat& format, const std::string& str)
+{
+    if (str == "text") format = EwiFormat::text;
+    else if (str == "json") format = EwiFormat::jsonLines;
+    else if (str == "sarif") format = EwiFormat::sarif;
+    else if (str == "quiet") format = EwiFormat::quiet;
+    else return 1;
+
+    return 0;
 }
 
 
@@ -418,6 +559,23 @@ ArgProcResult potoroo::argProc(ArgList& args)
     if (args.contains(ArgType::help)) return ArgProcResult::printHelp;
     if (args.contains(ArgType::version)) return ArgProcResult::printVersion;
 
+    if (args.contains(ArgType::serve))
+    {
+        size_t nJobs;
+        const bool jobsValid = (!args.contains(ArgType::jobs) || ((args.count(ArgType::jobs) == 1) && (jobsStrToCount(nJobs, args.get(ArgType::jobs).getValue()) == 0)));
+        const size_t n = (args.contains(ArgType::jobs) ? 2 : 1);
+
+        if ((args.count() == n) && (args.count(ArgType::serve) == 1) && args.get(ArgType::serve).isValid() && jobsValid) return ArgProcResult::serve;
+        else return ArgProcResult::error;
+    }
+
+    // the other arguments are checked by the server
+    if (args.contains(ArgType::connect))
+    {
+        if ((args.count(ArgType::connect) == 1) && args.get(ArgType::connect).isValid() && !args.contains(ArgType::watch)) return ArgProcResult::connect;
+        else return ArgProcResult::error;
+    }
+
     if (argProc_cond(args, 0))
     {
         Arg defaultJobFile(argStr_jf);
@@ -427,7 +585,21 @@ ArgProcResult potoroo::argProc(ArgList& args)
 
     if (args.contains(ArgType::jobFile))
     {
-        if (argProc_cond(args, 1) && (args.get(ArgType::jobFile).isValid())) return ArgProcResult::loadFile;
+        size_t nJobs;
+        const bool jobsValid = (!args.contains(ArgType::jobs) || ((args.count(ArgType::jobs) == 1) && (jobsStrToCount(nJobs, args.get(ArgType::jobs).getValue()) == 0)));
+
+        // the watch mode keeps its state in memory and runs endless
+        const bool watchValid = (!args.contains(ArgType::watch) || (!args.contains(ArgType::incremental) && !args.contains(ArgType::incrementalHash) && !args.contains(ArgType::stats) && !args.contains(ArgType::trace)));
+
+        const bool traceValid = ((args.count(ArgType::trace) <= 1) && (!args.contains(ArgType::trace) || args.get(ArgType::trace).isValid()));
+
+        EwiFormat format = EwiFormat::text;
+        bool diagValid = (!args.contains(ArgType::diag) || ((args.count(ArgType::diag) == 1) && (diagStrToFormat(format, args.get(ArgType::diag).getValue()) == 0)));
+
+        // the text report of --stats would break the machine readable output
+        if (((format == EwiFormat::jsonLines) || (format == EwiFormat::sarif)) && args.contains(ArgType::stats) && (args.get(ArgType::stats).getValue() != "json")) diagValid = false;
+
+        if (argProc_cond(args, 1) && (args.get(ArgType::jobFile).isValid()) && jobsValid && watchValid && traceValid && diagValid) return ArgProcResult::loadFile;
         else return ArgProcResult::error;
     }
 
@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "project.h"
+#include "middleware/util.h"
 
 namespace potoroo
 {
@@ -22,11 +23,23 @@ namespace potoroo
     const std::string argStr_od = "-od";
     const std::string argStr_tag = "-t";
     const std::string argStr_forceJf = "--force-jf";
+    const std::string argStr_jobs = "-j";
+    const std::string argStr_incremental = "--incremental";
+    const std::string argStr_incrementalHash = "--incremental-hash";
+    const std::string argStr_watch = "--watch";
+    const std::string argStr_serve = "--serve";
+    const std::string argStr_connect = "--connect";
+    const std::string argStr_stats = "--stats";
+    const std::string argStr_statsJson = "--stats=json";
+    const std::string argStr_trace = "--trace";
+    const std::string argStr_diag = "--diag";
     const std::string argStr_wError = "-Werror";
     const std::string argStr_wSup = "-Wsup";
     const std::string argStr_wrErrLn = "--write-error-line";
+    const std::string argStr_wrIfChanged = "--write-if-changed";
     const std::string argStr_copy = "--copy";
     const std::string argStr_copyow = "--copy-ow";
+    const std::string argStr_copycmp = "--copy-cmp";
     const std::string argStr_help = "-h";
     const std::string argStr_help_alt = "--help";
     const std::string argStr_version = "-v";
@@ -44,11 +57,22 @@ namespace potoroo
         outFile,
         tag,
         forceJf,
+        jobs,
+        incremental,
+        incrementalHash,
+        watch,
+        serve,
+        connect,
+        stats,
+        trace,
+        diag,
         wError,
         wSup,
         wrErrLn,
+        wrIfChanged,
         copy,
-        copyow
+        copyow,
+        copycmp
     };
 
     enum class ArgProcResult
@@ -57,6 +81,8 @@ namespace potoroo
 
         loadFile,
         process,
+        serve,
+        connect,
         printVersion,
         printHelp
     };
@@ -68,7 +94,7 @@ namespace potoroo
         Arg(const std::string& arg);
 
         ArgType getType() const;
-        std::string getValue() const;
+        const std::string& getValue() const;
 
         void setValue(const std::string& value);
 
@@ -94,7 +120,7 @@ namespace potoroo
         void clear();
         bool contains(ArgType at) const;
         bool containsInvalid() const;
-        Arg get(ArgType at) const;
+        const Arg& get(ArgType at) const;
         size_t count() const;
         size_t count(ArgType at) const;
 
@@ -111,6 +137,8 @@ namespace potoroo
     };
 
     int wSupStrListToVector(std::vector<int>& list, const std::string& strList);
+    int jobsStrToCount(size_t& n, const std::string& str);
+    int diagStrToFormat(EwiFormat& format, const std::string& str);
 
     ArgProcResult argProc(ArgList& args);
     ArgProcResult argProcJF(const ArgList& args, std::string& errMsg);
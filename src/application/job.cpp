@@ -6,15 +6,18 @@
 
 */
 
+#include <cstring>
 #include <filesystem>
-#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "job.h"
 #include "middleware/cliTextFormat.h"
+#include "middleware/inputFile.h"
 
 namespace fs = std::filesystem;
 
@@ -24,20 +27,87 @@ using namespace potoroo;
 
 namespace
 {
-    struct JobFileLine
+    const string_view defaultWrErrLnStr = "--write-error-line";
+
+    //! @brief Memory for the strings of jobs which are not part of the jobfile, stored strings never move
+    class JobArena
     {
-        JobFileLine() : line(0), data("") {}
-        JobFileLine(size_t l, const std::string& d) : line(l), data(d) {}
+    public:
+        explicit JobArena(size_t chunkSize) : chunkSize(chunkSize), pos(nullptr), left(0) {}
+
+        //! @brief Makes sure that the next allocations of size bytes in total don't need a new chunk
+        void reserve(size_t size)
+        {
+            if (size > left)
+            {
+                chunks.emplace_back(new char[size]);
+                pos = chunks.back().get();
+                left = size;
+            }
+        }
+
+        char* alloc(size_t size)
+        {
+            if (size > left) reserve((size > chunkSize) ? size : chunkSize);
+
+            char* const p = pos;
+            pos += size;
+            left -= size;
+
+            return p;
+        }
+
+        //! @brief Gives back the unused end of the last allocation
+        void shrink(size_t unused)
+        {
+            pos -= unused;
+            left += unused;
+        }
 
-        //! @brief Display line number
-        //! 0 is an invalid line number.
-        size_t line;
+        string_view store(string_view str)
+        {
+            if (str.empty()) return string_view();
+
+            char* const p = alloc(str.size());
+            memcpy(p, str.data(), str.size());
+
+            return string_view(p, str.size());
+        }
 
-        std::string data;
+    private:
+        vector<unique_ptr<char[]>> chunks;
+        size_t chunkSize;
+        char* pos;
+        size_t left;
     };
 
+    //! @brief The buffer shared by the jobs of a jobfile
+    struct JobBuffer
+    {
+        explicit JobBuffer(size_t arenaChunkSize) : arena(arenaChunkSize) {}
 
+        InputFile file;
+        string baseDir;
+        JobArena arena;
+    };
 
+    //! @brief Arguments of a job, views into the jobfile or the argument list
+    struct JobArgs
+    {
+        JobArgs() : hasOutFile(false), hasWSup(false), wError(false), wrErrLn(false), wrIfChanged(false), mode(JobMode::proc) {}
+
+        string_view in;
+        string_view out; // output file or directory
+        bool hasOutFile;
+        string_view tag; // empty if none
+        string_view wSup;
+        bool hasWSup;
+        bool wError;
+        bool wrErrLn;
+        string_view wrErrLnStr;
+        bool wrIfChanged;
+        JobMode mode;
+    };
 
     void printError(const std::string& file, const std::string& text, size_t line = 0, size_t col = 0)
     {
@@ -49,7 +119,7 @@ namespace
         printEWI(file, text, line, col, 1, 0);
     }
 
-    bool tagCondCpp(const string& ext)
+    bool tagCondCpp(string_view ext)
     {
         return (
             (ext == ".php") ||
@@ -61,14 +131,14 @@ namespace
             );
     }
 
-    bool tagCondBash(const string& ext)
+    bool tagCondBash(string_view ext)
     {
         return (
             (ext == ".sh")
             );
     }
 
-    bool tagCondBatch(const string& ext)
+    bool tagCondBatch(string_view ext)
     {
         return (
             (ext == ".bat") ||
@@ -76,6 +146,47 @@ namespace
             );
     }
 
+    //! @brief Like fs::path(path).lexically_normal().string()
+    //! @return View into path, or into the arena if the path had to be changed more than dropping a leading "./"
+    //!
+    //! On Unix, paths without "." and ".." (except leading "..") and without repeated separators
+    //! are normal apart from leading "./". They are the common case in jobfiles and are handled
+    //! without building a std::filesystem::path.
+    //!
+    string_view lexicallyNormal(string_view path, JobArena& arena)
+    {
+#if PRJ_PLAT_UNIX
+        size_t begin = 0;
+        while (path.compare(begin, 2, "./") == 0) begin += 2;
+
+        bool simple = (begin < path.length());
+        bool name = false;
+        const bool absolute = ((begin == 0) && (path.compare(0, 1, "/") == 0));
+        string_view last;
+
+        for (size_t i = (absolute ? 1 : begin); simple && (i < path.length());)
+        {
+            size_t end = path.find('/', i);
+            if (end == string_view::npos) end = path.length();
+
+            last = path.substr(i, end - i);
+
+            if (last.empty() || (last == ".")) simple = false;
+            else if (last == "..") simple = !(name || absolute);
+            else name = true;
+
+            i = end + 1;
+        }
+
+        // a trailing separator after ".." is removed
+        if (simple && (path.back() == '/') && (last == "..")) simple = false;
+
+        if (simple) return path.substr(begin);
+#endif
+
+        return arena.store(fs::path(path).lexically_normal().string());
+    }
+
     Job invalidInFilenameJob(const string& filename, const string& moreInfo)
     {
         Job j;
@@ -90,84 +201,268 @@ namespace
         return j;
     }
 
-    void jobFileExtractLines(const char* const data, const char* const end, vector<JobFileLine>& lines)
+    //! @brief Creates the job, the strings are views into args or stored in the arena
+    //! @param args
+    //! @param arena
+    //! @param buffer Owner of the args strings and the arena
+    Job makeJob(const JobArgs& args, JobArena& arena, const shared_ptr<const void>& buffer)
     {
-        size_t line = 1;
-        const char* p = data;
+        string_view in = args.in;
+        string_view out;
+        string_view ext;
+        string_view tag;
+
+#if PRJ_PLAT_UNIX
+        // like below, without building std::filesystem::path objects
+        const size_t sepPos = args.in.rfind('/');
+        const string_view filename = args.in.substr((sepPos == string_view::npos) ? 0 : (sepPos + 1));
+        const size_t extPos = filename.rfind('.');
 
-        // end-1 to make clean CRLR checks, needs the file to be terminated
-        // with unimportent data (such as LF, comments or whitespace)
-        while (p < (end - 1))
+        if ((extPos != string_view::npos) && (extPos != 0) && (filename != "..")) ext = filename.substr(extPos);
+
+        if (args.hasOutFile) out = args.out;
+        else
         {
-            // skip whitespace
-            while (((*p == 0x09) || (*p == 0x20)) && (p < (end - 1))) ++p;
+            const bool sep = (!args.out.empty() && (args.out.back() != '/'));
+            char* const p = arena.alloc(args.out.size() + (sep ? 1 : 0) + filename.size());
+            char* q = p;
 
-            // comment
-            if (*p == jfcc)
+            memcpy(q, args.out.data(), args.out.size());
+            q += args.out.size();
+            if (sep) *q++ = '/';
+            memcpy(q, filename.data(), filename.size());
+            q += filename.size();
+
+            out = string_view(p, q - p);
+        }
+#else
+        fs::path inPath;
+
+        try { inPath = fs::path(in); }
+        catch (exception& ex) { return invalidInFilenameJob(string(in), ex.what()); }
+        catch (...) { return invalidInFilenameJob(string(in), ""); }
+
+        if (args.hasOutFile)
+        {
+            out = args.out;
+        }
+        else
+        {
+            try
             {
-                while (
-                    (*p != 0x0A) &&
-                    ((*p != 0x0D) || (*(p + 1) != 0x0A)) &&
-                    (p < (end - 1))
-                    )
-                {
-                    ++p;
-                }
+                fs::path p(args.out);
+                p /= inPath.filename();
+                out = arena.store(p.string());
+            }
+            catch (...)
+            {
+                out = args.out;
+                // further exception handling in processor
             }
+        }
+
+        try { ext = arena.store(inPath.extension().string()); }
+        catch (exception& ex) { return invalidInFilenameJob(string(in), ex.what()); }
+        catch (...) { return invalidInFilenameJob(string(in), ""); }
+#endif
 
-            // LF
-            else if (*p == 0x0A)
+        if (args.mode == JobMode::proc)
+        {
+            if (args.tag.compare(0, 7, "custom:") == 0) tag = args.tag.substr(7);
+            else if (tagCondCpp(ext) || (args.tag == "cpp")) tag = tagCpp;
+            else if (tagCondBash(ext) || (args.tag == "bash")) tag = tagBash;
+            else if (tagCondBatch(ext) || (args.tag == "batch")) tag = tagBatch;
+            else
             {
-                ++p;
-                ++line;
+                Job j;
+                j.setValidity(false);
+                j.setErrorMsg("unable to determine tag");
+                return j;
             }
+        }
+
+        if ((args.mode == JobMode::proc) && ((tag.length() > 15) || (tag.length() < 3)))
+        {
+            Job j;
+            j.setValidity(false);
+            j.setErrorMsg("invalid tag length");
+            return j;
+        }
+
+        try
+        {
+            try { in = lexicallyNormal(in, arena); }
+            catch (...) {}
+
+            try { out = lexicallyNormal(out, arena); }
+            catch (...) {}
+
+            Job j(buffer, in, out, tag, args.wError, args.wrErrLn, args.wrErrLnStr, args.mode);
+            j.setWriteIfChanged(args.wrIfChanged);
 
-            // CRLF
-            else if ((*p == 0x0D) && (*(p + 1) == 0x0A))
+            if (args.hasWSup && (j.setWSupList(string(args.wSup)) != 0))
             {
-                p += 2;
-                ++line;
+                j.setWSupList(nullptr, 0);
+                j.setValidity(false);
+                j.setErrorMsg("invalid " + argStr_wSup + " LIST");
             }
 
-            // data
-            else
+            return j;
+        }
+        catch (exception& ex) { return invalidInFilenameJob(string(in), ex.what()); }
+        catch (...) { return invalidInFilenameJob(string(in), ""); }
+    }
+
+    //! @brief Copies the strings to the arena, for arguments which don't live as long as the job
+    void storeJobArgs(JobArgs& args, JobArena& arena)
+    {
+        args.in = arena.store(args.in);
+        args.out = arena.store(args.out);
+        args.tag = arena.store(args.tag);
+        args.wrErrLnStr = arena.store(args.wrErrLnStr);
+    }
+
+    //! @brief The views are valid as long as args
+    JobArgs getJobArgs(const ArgList& args)
+    {
+        JobArgs jobArgs;
+
+        jobArgs.in = args.get(ArgType::inFile).getValue();
+        jobArgs.hasOutFile = args.contains(ArgType::outFile);
+        jobArgs.out = args.get(jobArgs.hasOutFile ? ArgType::outFile : ArgType::outDir).getValue();
+        jobArgs.tag = args.get(ArgType::tag).getValue();
+        jobArgs.wSup = args.get(ArgType::wSup).getValue();
+        jobArgs.hasWSup = args.get(ArgType::wSup).isValid();
+        jobArgs.wError = args.contains(ArgType::wError);
+        jobArgs.wrErrLn = args.contains(ArgType::wrErrLn);
+        jobArgs.wrErrLnStr = args.get(ArgType::wrErrLn).getValue();
+        jobArgs.wrIfChanged = args.contains(ArgType::wrIfChanged);
+
+        if (args.contains(ArgType::copy)) jobArgs.mode = JobMode::copy;
+        if (args.contains(ArgType::copyow)) jobArgs.mode = JobMode::copyow;
+        if (args.contains(ArgType::copycmp)) jobArgs.mode = JobMode::copycmp;
+
+        return jobArgs;
+    }
+
+    //! @brief Reads the next argument of a jobfile line, like ArgList::parse(const char*)
+    //! @param p
+    //! @param end
+    //! @param [out] arg View into the line, or into the arena if the argument contains escape sequences
+    //! @param arena
+    //! @return false at the end of the line
+    bool jobFileNextArg(const char*& p, const char* const end, string_view& arg, JobArena& arena)
+    {
+        while ((p < end) && ((*p == 0x09) || (*p == 0x20))) ++p;
+
+        if (p >= end) return false;
+
+        const char* const begin = p;
+
+        if (*p == '"')
+        {
+            ++p;
+
+            const char* const valueBegin = p;
+
+            while ((p < end) && (*p != '"') && (*p != '\\')) ++p;
+
+            if ((p < end) && (*p == '\\'))
             {
-                JobFileLine argl;
-                argl.data = "";
-                argl.line = line;
-
-                while (
-                    (*p != 0x0A) &&
-                    ((*p != 0x0D) || (*(p + 1) != 0x0A)) &&
-                    (p < (end - 1))
-                    )
+                // a backslash is removed, unless it follows one, and makes a quote part of the value
+                char* const value = arena.alloc(end - valueBegin);
+                char* q = value;
+
+                for (p = valueBegin; (p < end) && ((*p != '"') || (*(p - 1) == '\\')); ++p)
                 {
-                    argl.data += *p;
-                    ++p;
+                    if ((*p != '\\') || (*(p - 1) == '\\')) *q++ = *p;
                 }
 
-                lines.push_back(argl);
+                arena.shrink((end - valueBegin) - (q - value));
+                arg = string_view(value, q - value);
             }
+            else arg = string_view(valueBegin, p - valueBegin);
+
+            if (p < end) ++p; // closing quote
         }
+        else
+        {
+            while ((p < end) && (*p != 0x09) && (*p != 0x20)) ++p;
+
+            arg = string_view(begin, p - begin);
+        }
+
+        return true;
     }
 
-    //! @brief Reads the jobfile and prepares lines for parsing
-    //! @param filename 
-    //! @param [out] lines 
+    //! @brief Parses a jobfile line which only consists of the usual arguments, each at most once
+    //! @param p
+    //! @param end
+    //! @param [out] args
+    //! @param arena
+    //! @return false if the line has to be checked by argProcJF()
+    bool jobFileParseLine(const char* p, const char* const end, JobArgs& args, JobArena& arena)
+    {
+        enum
+        {
+            seen_in = 0x01,
+            seen_out = 0x02,
+            seen_tag = 0x04,
+            seen_wError = 0x08,
+            seen_wSup = 0x10,
+            seen_wrErrLn = 0x20,
+            seen_wrIfChanged = 0x40,
+            seen_copy = 0x80
+        };
+
+        int seen = 0;
+        string_view arg;
+
+        args = JobArgs();
+
+        while (jobFileNextArg(p, end, arg, arena))
+        {
+            int flag;
+            string_view* value = nullptr;
+
+            if (arg == argStr_if) { flag = seen_in; value = &args.in; }
+            else if (arg == argStr_of) { flag = seen_out; value = &args.out; args.hasOutFile = true; }
+            else if (arg == argStr_od) { flag = seen_out; value = &args.out; }
+            else if (arg == argStr_tag) { flag = seen_tag; value = &args.tag; }
+            else if (arg == argStr_wError) { flag = seen_wError; args.wError = true; }
+            else if (arg == argStr_wSup) { flag = seen_wSup; value = &args.wSup; args.hasWSup = true; }
+            else if (arg == argStr_wrErrLn) { flag = seen_wrErrLn; value = &args.wrErrLnStr; args.wrErrLn = true; }
+            else if (arg == argStr_wrIfChanged) { flag = seen_wrIfChanged; args.wrIfChanged = true; }
+            else if (arg == argStr_copy) { flag = seen_copy; args.mode = JobMode::copy; }
+            else if (arg == argStr_copyow) { flag = seen_copy; args.mode = JobMode::copyow; }
+            else if (arg == argStr_copycmp) { flag = seen_copy; args.mode = JobMode::copycmp; }
+            else return false;
+
+            if (seen & flag) return false;
+            seen |= flag;
+
+            if (value && !jobFileNextArg(p, end, *value, arena)) return false;
+        }
+
+        return ((seen & (seen_in | seen_out)) == (seen_in | seen_out));
+    }
+
+    //! @brief Reads the jobfile
+    //! @param filename
+    //! @param file
+    //! @param [out] data Content of the file without the BOM
+    //! @param [out] end
     //! @return 0 on success
-    Result readJobFile(const std::string& filename, vector<JobFileLine>& lines)
+    Result readJobFile(const std::string& filename, InputFile& file, const char*& data, const char*& end)
     {
         const string procStr = "read jobfile";
         Result result;
-        char* fileBuff = nullptr;
+
+        data = nullptr;
+        end = nullptr;
 
         try
         {
-            ifstream jfs;
-
-            size_t fileSize = 0;
-            streampos fileSizeL = 0;
-
             fs::path jobfile(filename);
 
             if (!fs::exists(jobfile))
@@ -179,18 +474,12 @@ namespace
 #endif
             }
 
-            jfs.exceptions(ios::failbit | ios::badbit | ios::eofbit);
-            jfs.open(jobfile, ios::binary | ios::in);
-
-            jfs.seekg(0, ios::end);
-            fileSizeL = jfs.tellg();
-            jfs.seekg(0, ios::beg);
+            // the jobs refer to the data as long as they exist, it's read instead of mapped
+            string errMsg;
+            if (file.read(jobfile, errMsg) != 0) throw runtime_error(errMsg);
 
-            if (fileSizeL > static_cast<size_t>(-1))
-            {
-                throw runtime_error("file too big");
-            }
-            else fileSize = static_cast<size_t>(fileSizeL);
+            const char* const fileBuff = file.data();
+            const size_t fileSize = file.size();
 
             if (fileSize == 0)
             {
@@ -206,45 +495,22 @@ namespace
                 throw runtime_error("invalid file");
             }
 
-
-
-
-
-
-            //
-            // new
-            //
-
-            fileBuff = new char[fileSize];
-            jfs.read(fileBuff, fileSize);
-            try { jfs.close(); }
-            catch (exception& ex) { printWarning(procStr, "closing file failed: " + string(ex.what())); ++result.warn; }
-            catch (...) { printWarning(procStr, "closing file failed"); ++result.warn; }
-
             // UTF BOM check
             if (fileBuff[0] == static_cast<char>(0x00) && fileBuff[1] == static_cast<char>(0x00) && fileBuff[2] == static_cast<char>(0xFe) && fileBuff[3] == static_cast<char>(0xFF)) throw runtime_error("encoding not supported: UTF-32 BE");
             if (fileBuff[0] == static_cast<char>(0xFF) && fileBuff[1] == static_cast<char>(0xFe) && fileBuff[2] == static_cast<char>(0x00) && fileBuff[3] == static_cast<char>(0x00)) throw runtime_error("encoding not supported: UTF-32 LE");
             if (fileBuff[0] == static_cast<char>(0xFe) && fileBuff[1] == static_cast<char>(0xFF)) throw runtime_error("encoding not supported: UTF-16 BE");
             if (fileBuff[0] == static_cast<char>(0xFF) && fileBuff[1] == static_cast<char>(0xFe)) throw runtime_error("encoding not supported: UTF-16 LE");
 
-            const char* tmpFB = fileBuff;
-            if (fileBuff[0] == static_cast<char>(0xeF) && fileBuff[1] == static_cast<char>(0xBB) && fileBuff[2] == static_cast<char>(0xBF)) tmpFB += 3; // skip UTF-8 BOM
+            data = fileBuff;
+            if (fileBuff[0] == static_cast<char>(0xeF) && fileBuff[1] == static_cast<char>(0xBB) && fileBuff[2] == static_cast<char>(0xBF)) data += 3; // skip UTF-8 BOM
+
+            end = fileBuff + fileSize;
 
-            if (fileSize > 0)
+            if (fileBuff[fileSize - 1] != 0x0A)
             {
-                if (fileBuff[fileSize - 1] != 0x0A)
-                {
-                    printWarning(procStr, "file does not end with a new line (may cause jobfile parse errors)");
-                    ++result.warn;
-                }
+                printWarning(procStr, "file does not end with a new line (may cause jobfile parse errors)");
+                ++result.warn;
             }
-
-            jobFileExtractLines(tmpFB, fileBuff + fileSize, lines);
-        }
-        catch (ios::failure& ex)
-        {
-            printError(procStr + ": IO", ex.what());
-            result = -1;
         }
         catch (exception& ex)
         {
@@ -257,8 +523,6 @@ namespace
             result = -1;
         }
 
-        delete[] fileBuff;
-
         return result;
     }
 }
@@ -267,9 +531,8 @@ namespace
 
 
 potoroo::Job::Job()
-    : wError(false), wrErrLn(false), wrErrLnStr("--write-error-line"), validity(false), errorMsg("unset"), mode(JobMode::proc)
+    : mode(JobMode::proc), wError(false), wrErrLn(false), wrErrLnStr(defaultWrErrLnStr), wrIfChanged(false), validity(false), errorMsg("unset")
 {
-    setWSupList(nullptr, 0);
 }
 
 potoroo::Job::Job(const std::string& inputFile, const std::string& outputFile, const std::string& tag,
@@ -277,16 +540,19 @@ potoroo::Job::Job(const std::string& inputFile, const std::string& outputFile, c
     bool writeErrorLine, const std::string& writeErrorLineStr,
     JobMode jobMode,
     const std::string* wSup)
-    : tag(tag), wError(warningAsError), wrErrLn(writeErrorLine), wrErrLnStr(writeErrorLineStr), validity(true), mode(jobMode)
+    : mode(jobMode), wError(warningAsError), wrErrLn(writeErrorLine), wrIfChanged(false), validity(true)
 {
-    try { inFile = fs::path(inputFile).lexically_normal().string(); }
-    catch (...) { inFile = string(inputFile); }
+    JobArena arena(256);
+    string_view in = inputFile;
+    string_view out = outputFile;
 
-    try { outFile = fs::path(outputFile).lexically_normal().string(); }
-    catch (...) { outFile = string(outputFile); }
+    try { in = lexicallyNormal(inputFile, arena); }
+    catch (...) {}
 
-    errorMsg.clear();
-    errorMsg.shrink_to_fit();
+    try { out = lexicallyNormal(outputFile, arena); }
+    catch (...) {}
+
+    setStrings(in, out, string_view(), tag, writeErrorLineStr);
 
     if (wSup)
     {
@@ -297,7 +563,16 @@ potoroo::Job::Job(const std::string& inputFile, const std::string& outputFile, c
             errorMsg = "invalid " + argStr_wSup + " LIST";
         }
     }
-    else setWSupList(nullptr, 0);
+}
+
+//! @brief Creates a job without copying the strings
+//!
+//! The views have to be valid as long as buffer exists.
+//!
+potoroo::Job::Job(const std::shared_ptr<const void>& buffer, std::string_view inputFile, std::string_view outputFile, std::string_view tag,
+    bool warningAsError, bool writeErrorLine, std::string_view writeErrorLineStr, JobMode jobMode)
+    : buffer(buffer), inFile(inputFile), outFile(outputFile), tag(tag), mode(jobMode), wError(warningAsError), wrErrLn(writeErrorLine), wrErrLnStr(writeErrorLineStr), wrIfChanged(false), validity(true)
+{
 }
 
 void potoroo::Job::setValidity(bool validity)
@@ -312,17 +587,41 @@ void potoroo::Job::setErrorMsg(const std::string& msg)
 
 std::string potoroo::Job::getInputFile() const
 {
-    return inFile;
+    return string(inFile);
 }
 
 std::string potoroo::Job::getOutputFile() const
 {
-    return outFile;
+    return string(outFile);
+}
+
+//! @brief Directory relative in and out paths are based on, the current working directory if empty
+std::string potoroo::Job::getBaseDir() const
+{
+    return string(baseDir);
+}
+
+//! @brief Absolute path of the input file
+//!
+//! May throw, like std::filesystem::absolute().
+//!
+std::filesystem::path potoroo::Job::getInputPath() const
+{
+    return fs::absolute(fs::path(baseDir) / inFile);
+}
+
+//! @brief Absolute path of the output file
+//!
+//! May throw, like std::filesystem::absolute().
+//!
+std::filesystem::path potoroo::Job::getOutputPath() const
+{
+    return fs::absolute(fs::path(baseDir) / outFile);
 }
 
 std::string potoroo::Job::getTag() const
 {
-    return tag;
+    return string(tag);
 }
 
 JobMode potoroo::Job::getMode() const
@@ -342,7 +641,12 @@ bool potoroo::Job::writeErrorLine() const
 
 std::string potoroo::Job::writeErrorLineStr() const
 {
-    return wrErrLnStr;
+    return string(wrErrLnStr);
+}
+
+bool potoroo::Job::writeIfChanged() const
+{
+    return wrIfChanged;
 }
 
 const std::vector<int>& potoroo::Job::getWSupList() const
@@ -352,17 +656,22 @@ const std::vector<int>& potoroo::Job::getWSupList() const
 
 void potoroo::Job::setInputFile(const std::string& inputFile)
 {
-    inFile = inputFile;
+    setStrings(inputFile, outFile, baseDir, tag, wrErrLnStr);
 }
 
 void potoroo::Job::setOutputFile(const std::string& outputFile)
 {
-    outFile = outputFile;
+    setStrings(inFile, outputFile, baseDir, tag, wrErrLnStr);
+}
+
+void potoroo::Job::setBaseDir(const std::string& dir)
+{
+    setStrings(inFile, outFile, dir, tag, wrErrLnStr);
 }
 
 void potoroo::Job::setTag(const std::string& t)
 {
-    tag = t;
+    setStrings(inFile, outFile, baseDir, t, wrErrLnStr);
 }
 
 void potoroo::Job::setMode(const JobMode& m)
@@ -380,6 +689,11 @@ void potoroo::Job::clrWarningAsError()
     setWarningAsError(false);
 }
 
+void potoroo::Job::setWriteIfChanged(bool writeIfChanged)
+{
+    wrIfChanged = writeIfChanged;
+}
+
 void potoroo::Job::setWSupList(const int* list, size_t count)
 {
     std::vector<int> tmpList;
@@ -402,7 +716,7 @@ void potoroo::Job::setWSupList(const std::vector<int>& list)
 int potoroo::Job::setWSupList(const std::string& list)
 {
     wSupList.clear();
-    return wSupListAddRange(list);
+    return wSupStrListToVector(wSupList, list);
 }
 
 void potoroo::Job::wSupListAdd(int wID)
@@ -461,6 +775,34 @@ std::string potoroo::Job::getErrorMsg() const
     return errorMsg;
 }
 
+//! @brief Copies the strings to a new buffer of the job
+//!
+//! The arguments may refer to the old buffer, it's released after the copy.
+//!
+void potoroo::Job::setStrings(std::string_view inputFile, std::string_view outputFile, std::string_view dir, std::string_view t, std::string_view writeErrorLineStr)
+{
+    const string_view src[] = { inputFile, outputFile, dir, t, writeErrorLineStr };
+    string_view* const dst[] = { &inFile, &outFile, &baseDir, &tag, &wrErrLnStr };
+    const size_t count = sizeof(src) / sizeof(src[0]);
+
+    size_t size = 0;
+    for (size_t i = 0; i < count; ++i) size += src[i].size();
+
+    const shared_ptr<string> newBuffer = make_shared<string>();
+    newBuffer->reserve(size);
+    for (size_t i = 0; i < count; ++i) newBuffer->append(src[i]);
+
+    size_t pos = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        *dst[i] = string_view(newBuffer->data() + pos, src[i].size());
+        pos += src[i].size();
+    }
+
+    buffer = newBuffer;
+}
+
 std::ostream& potoroo::operator<<(std::ostream& os, const Job& j)
 {
     os << "\"" << j.getInputFile() << "\" \"" << j.getOutputFile() << "\"";
@@ -468,11 +810,13 @@ std::ostream& potoroo::operator<<(std::ostream& os, const Job& j)
     if (j.getMode() == JobMode::proc) os << " \"" << j.getTag() << "\"";
     else if (j.getMode() == JobMode::copy) os << " copy";
     else if (j.getMode() == JobMode::copyow) os << " copy-ow";
+    else if (j.getMode() == JobMode::copycmp) os << " copy-cmp";
     else os << " #invalid job mode#";
 
     if (j.warningAsError()) os << " Werror";
     if (j.getWSupList().size() > 0) os << " Wsup " + j.wSupListToString();
     if (j.writeErrorLine()) os << " " << argStr_wrErrLn;
+    if (j.writeIfChanged()) os << " " << argStr_wrIfChanged;
 
     return os;
 }
@@ -487,140 +831,144 @@ std::ostream& potoroo::operator<<(std::ostream& os, const Job& j)
 //! - 0 on success
 //! - >0 number of parse errors
 //! 
+//! The lines are parsed in place. The strings of the jobs are views into the read file, or into
+//! an arena if they had to be changed (escape sequences, output paths of -od), both are owned by
+//! a buffer shared by the jobs. Only lines with unusual arguments are parsed by ArgList::parse()
+//! and checked by argProcJF().
+//! 
 Result potoroo::Job::parseFile(const std::string& filename, std::vector<Job>& jobs)
 {
-    vector<JobFileLine> line;
+    shared_ptr<JobBuffer> jobBuffer = make_shared<JobBuffer>(64 * 1024);
+    const shared_ptr<const void> buffer = jobBuffer;
+    JobArena& arena = jobBuffer->arena;
 
-#if PRJ_DEBUG && 0
-    /*char* line[] =
-    {
-        "-if \"./a dir/asdf.ext\"  \t  -od ../../000\t-Werror",
-        "-if \"./a dir/asdf.ext\"  \t  -of ./ptro\t-Werror -tag cpp        ",
-        "-if \"./a dir/asdf.ext\" -of ./ptro -Werror -tag cpp",
-        "    -if \"./a dir/asdf.ext\"  \t  -od ../../000\t-Werror -tag custom:\"*p",
-        "    -if \"./a dir/asdf.ext\" -od ../../000 -Werror -tag custom:\"*p",
-        "-if index.js -od ./deploy",
-        "-if index.js -od ./deploy -of a",
-        "-if ./sdf/ -od . -tag batch"
-    };*/
-
-    Result r;
-    size_t ___dbg_l = 0;
-
-    line.push_back(JobFileLine(++___dbg_l, "-if \"./a dir/asdf.ext\"  \t  -od ../../000\t-Werror"));
-    line.push_back(JobFileLine(++___dbg_l, "-if \"./a dir/asdf.ext\"  \t  -of ./ptro\t-Werror -tag cpp        "));
-    line.push_back(JobFileLine(++___dbg_l, "-if \"./a dir/asdf.ext\" -of ./ptro -Werror -tag cpp"));
-    line.push_back(JobFileLine(++___dbg_l, "    -if \"./a dir/asdf.ext\"  \t  -od ../../000\t-Werror -tag custom:\"*p"));
-    line.push_back(JobFileLine(++___dbg_l, "    -if \"./a dir/asdf.ext\" -od ../../000 -Werror -tag custom:\"*p"));
-    line.push_back(JobFileLine(++___dbg_l, "-if index.js -od ./deploy"));
-    line.push_back(JobFileLine(++___dbg_l, "-if index.js -od ./deploy -of a"));
-    line.push_back(JobFileLine(++___dbg_l, "-if ./sdf/ -od . -tag batc"));
-    line.push_back(JobFileLine(++___dbg_l, "-if ./sdf/ -od . -tag batch"));
-#else
-    Result r = readJobFile(filename, line);
+    const char* data;
+    const char* end;
+
+    Result r = readJobFile(filename, jobBuffer->file, data, end);
     if (r.err != 0) return -1;
-#endif
+    if (!data) return r;
+
+    // paths in the jobfile are relative to its containing directory
+    try { jobBuffer->baseDir = fs::absolute(fs::path(filename)).lexically_normal().parent_path().string(); }
+    catch (exception& ex)
+    {
+        printError("jobfile", ex.what());
+        return -1;
+    }
+    catch (...)
+    {
+        printError("jobfile", "invalid filename");
+        return -1;
+    }
+
+    const string_view baseDir = jobBuffer->baseDir;
+
+    // Enough for the unescaped arguments and the output paths of -od, normalized paths rarely
+    // need more. Only the used part of the chunk gets pages.
+    arena.reserve(2 * static_cast<size_t>(end - data) + 1024);
 
+    // counting the lines is cheap compared to moving the jobs while the vector grows
+    size_t nLines = 1;
+    for (const char* lf = data; (lf = static_cast<const char*>(memchr(lf, 0x0A, end - lf))) != nullptr; ++lf) ++nLines;
+    jobs.reserve(jobs.size() + nLines);
 
+    size_t line = 1;
+    const char* p = data;
 
-    for (size_t i = 0; i < line.size(); ++i)
+    // The last byte is never part of a line, the file has to be terminated with unimportant
+    // data (such as LF, comments or whitespace). This makes clean CRLF checks.
+    const char* const pMax = end - 1;
+
+    while (p < pMax)
     {
-        ArgList args = ArgList::parse(line[i].data.c_str());
+        // skip whitespace
+        while (((*p == 0x09) || (*p == 0x20)) && (p < pMax)) ++p;
 
-        string aprErrMsg = "";
-        ArgProcResult apr = argProcJF(args, aprErrMsg);
-        Job job = Job::parseArgs(args);
+        const char* lf = static_cast<const char*>(memchr(p, 0x0A, end - p));
+        if (!lf) lf = end;
 
-        if (apr != ArgProcResult::process)
+        if (*p == 0x0A)
         {
-            ++r.err;
-            printError("jobfile", aprErrMsg, line[i].line);
+            ++p;
+            ++line;
+            continue;
         }
-        else if (!job.isValid())
+
+        if ((*p == 0x0D) && ((p + 1) < end) && (*(p + 1) == 0x0A))
         {
-            ++r.err;
-            printError("jobfile", job.getErrorMsg(), line[i].line);
+            p += 2;
+            ++line;
+            continue;
         }
-#if PRJ_DEBUG && 0
-        jobs.push_back(job);
-#else
-        else
+
+        const char* lineEnd = lf;
+        if ((lineEnd > p) && (*(lineEnd - 1) == 0x0D)) --lineEnd;
+        if (lineEnd > pMax) lineEnd = pMax;
+
+        if (*p == jfcc)
         {
-            jobs.push_back(job);
-        }
-#endif  
+            p = lineEnd;
+            continue;
         }
 
-    return r;
-    }
-
-Job potoroo::Job::parseArgs(const ArgList& args)
-{
-    string in = args.get(ArgType::inFile).getValue();
-    fs::path inPath;
-    string out;
-    string tag;
+        // a NUL terminates the arguments
+        const char* const nul = static_cast<const char*>(memchr(p, 0, lineEnd - p));
+        const char* const argsEnd = (nul ? nul : lineEnd);
 
-    try { inPath = fs::path(in); }
-    catch (exception& ex) { return invalidInFilenameJob(in, ex.what()); }
-    catch (...) { return invalidInFilenameJob(in, ""); }
+        JobArgs jobArgs;
+        ArgList args;
+        bool argsOk = true;
+        string errMsg = "";
 
-    if (args.contains(ArgType::outFile))
-    {
-        out = args.get(ArgType::outFile).getValue();
-    }
-    else
-    {
-        try
-        {
-            fs::path p(args.get(ArgType::outDir).getValue());
-            p /= inPath.filename();
-            out = p.string();
-        }
-        catch (...)
+        if (!jobFileParseLine(p, argsEnd, jobArgs, arena))
         {
-            out = args.get(ArgType::outDir).getValue();
-            // further exception handling in processor
-        }
-    }
+            // unusual lines get the checks and error messages of the command line
+            args = ArgList::parse(string(p, argsEnd - p).c_str());
 
-    string ext;
-    try { ext = inPath.extension().string(); }
-    catch (exception& ex) { return invalidInFilenameJob(in, ex.what()); }
-    catch (...) { return invalidInFilenameJob(in, ""); }
+            argsOk = (argProcJF(args, errMsg) == ArgProcResult::process);
 
-    JobMode mode = JobMode::proc;
-    if (args.contains(ArgType::copy)) mode = JobMode::copy;
-    if (args.contains(ArgType::copyow)) mode = JobMode::copyow;
+            if (argsOk)
+            {
+                jobArgs = getJobArgs(args);
+                storeJobArgs(jobArgs, arena);
+            }
+        }
 
-    if (mode == JobMode::proc)
-    {
-        if (args.get(ArgType::tag).getValue().compare(0, 7, "custom:") == 0) tag = string(args.get(ArgType::tag).getValue(), 7);
-        else if (tagCondCpp(ext) || (args.get(ArgType::tag).getValue() == "cpp")) tag = tagCpp;
-        else if (tagCondBash(ext) || (args.get(ArgType::tag).getValue() == "bash")) tag = tagBash;
-        else if (tagCondBatch(ext) || (args.get(ArgType::tag).getValue() == "batch")) tag = tagBatch;
+        if (!argsOk)
+        {
+            ++r.err;
+            printError("jobfile", errMsg, line);
+        }
         else
         {
-            Job j;
-            j.setValidity(false);
-            j.setErrorMsg("unable to determine tag");
-            return j;
+            Job job = makeJob(jobArgs, arena, buffer);
+
+            if (!job.isValid())
+            {
+                ++r.err;
+                printError("jobfile", job.getErrorMsg(), line);
+            }
+            else
+            {
+                job.baseDir = baseDir; // part of the buffer
+                jobs.push_back(std::move(job));
+            }
         }
-    }
 
-    if ((mode == JobMode::proc) && ((tag.length() > 15) || (tag.length() < 3)))
-    {
-        Job j;
-        j.setValidity(false);
-        j.setErrorMsg("invalid tag length");
-        return j;
+        p = lineEnd;
     }
 
-    string tmpWSupList = args.get(ArgType::wSup).getValue();
-    string* wSupList = nullptr;
-    if (args.get(ArgType::wSup).isValid()) wSupList = &tmpWSupList;
+    return r;
+}
+
+Job potoroo::Job::parseArgs(const ArgList& args)
+{
+    const shared_ptr<JobBuffer> jobBuffer = make_shared<JobBuffer>(1024);
+
+    // the job outlives the argument list
+    JobArgs jobArgs = getJobArgs(args);
+    storeJobArgs(jobArgs, jobBuffer->arena);
 
-    try { return Job(inPath.string(), out, tag, args.contains(ArgType::wError), args.contains(ArgType::wrErrLn), args.get(ArgType::wrErrLn).getValue(), mode, wSupList); }
-    catch (exception& ex) { return invalidInFilenameJob(in, ex.what()); }
-    catch (...) { return invalidInFilenameJob(in, ""); }
+    return makeJob(jobArgs, jobBuffer->arena, jobBuffer);
 }
@@ -11,7 +11,9 @@
 
 #include <filesystem>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "arg.h"
@@ -30,9 +32,15 @@ namespace potoroo
     {
         proc,
         copy,
-        copyow
+        copyow,
+        copycmp
     };
 
+    //! @brief A job of the jobfile or the command line
+    //!
+    //! The strings are views into a buffer, which is shared by all jobs of a jobfile. Copying a
+    //! job does not copy the strings, the setters copy them to a new buffer of the job.
+    //!
     class Job
     {
     public:
@@ -42,25 +50,33 @@ namespace potoroo
             bool writeErrorLine = false, const std::string& writeErrorLineStr = std::string("--write-error-line"),
             JobMode mode = JobMode::proc,
             const std::string* wSup = nullptr);
+        Job(const std::shared_ptr<const void>& buffer, std::string_view inputFile, std::string_view outputFile, std::string_view tag,
+            bool warningAsError, bool writeErrorLine, std::string_view writeErrorLineStr, JobMode mode);
 
         void setValidity(bool validity);
         void setErrorMsg(const std::string& msg);
 
         std::string getInputFile() const;
         std::string getOutputFile() const;
+        std::string getBaseDir() const;
+        std::filesystem::path getInputPath() const;
+        std::filesystem::path getOutputPath() const;
         std::string getTag() const;
         JobMode getMode() const;
         bool warningAsError() const;
         bool writeErrorLine() const;
         std::string writeErrorLineStr() const;
+        bool writeIfChanged() const;
         const std::vector<int>& getWSupList() const;
 
         void setInputFile(const std::string& inputFile);
         void setOutputFile(const std::string& outputFile);
+        void setBaseDir(const std::string& dir);
         void setTag(const std::string& t);
         void setMode(const JobMode& m);
         void setWarningAsError(bool warningAsError = true);
         void clrWarningAsError();
+        void setWriteIfChanged(bool writeIfChanged = true);
         void setWSupList(const int* list, size_t count);
         void setWSupList(const std::vector<int>& list);
         int setWSupList(const std::string& list);
@@ -77,18 +93,23 @@ namespace potoroo
         friend std::ostream& operator<<(std::ostream& os, const Job& j);
 
     private:
-        std::string inFile;
-        std::string outFile;
-        std::string tag;
+        std::shared_ptr<const void> buffer; // owns the memory the views refer to
+        std::string_view inFile;
+        std::string_view outFile;
+        std::string_view baseDir;
+        std::string_view tag;
         JobMode mode;
         bool wError;
         bool wrErrLn;
-        std::string wrErrLnStr;
+        std::string_view wrErrLnStr;
+        bool wrIfChanged;
         std::vector<int> wSupList;
 
         bool validity = false;
         std::string errorMsg;
 
+        void setStrings(std::string_view inputFile, std::string_view outputFile, std::string_view dir, std::string_view t, std::string_view writeErrorLineStr);
+
     public:
         static Result parseFile(const std::string& filename, std::vector<Job>& jobs);
         static Job parseArgs(const ArgList& args);
@@ -6,16 +6,33 @@
 
 */
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "arg.h"
 #include "processor.h"
+#include "libpotoroo.h"
 #include "middleware/cliTextFormat.h"
+#include "middleware/fileMeta.h"
+#include "middleware/inputFile.h"
+#include "middleware/outputFile.h"
+#include "middleware/scanner.h"
+#include "middleware/trace.h"
 #include "middleware/util.h"
 
 namespace fs = std::filesystem;
@@ -26,11 +43,11 @@ using namespace potoroo;
 
 namespace
 {
-    const string keyword_rmStart = "rm";
-    const string keyword_rmEnd = "endrm";
-    const string keyword_rmn = "rmn";
-    const string keyword_ins = "ins";
-    const string keyword_include = "include";
+    constexpr string_view keyword_rmStart = "rm";
+    constexpr string_view keyword_rmEnd = "endrm";
+    constexpr string_view keyword_rmn = "rmn";
+    constexpr string_view keyword_ins = "ins";
+    constexpr string_view keyword_include = "include";
 
     //const char incPathType_path_Char = '<';
     //const char incPathType_path_CloseingChar = '>';
@@ -55,6 +72,7 @@ namespace
         wID_rmnEOF,
         wID_endlAssumeLF,
         wID_convEndlFail,
+        wID_endlMixed,
 
         _wID_last
     };
@@ -70,6 +88,48 @@ namespace
         include
     };
 
+    //! @brief Adds the time until stop() or its destruction to the counter, does nothing if the counter is nullptr
+    class StatsTimer
+    {
+    public:
+        StatsTimer(uint64_t* ns) : ns(ns)
+        {
+            if (ns) t0 = chrono::steady_clock::now();
+        }
+
+        ~StatsTimer() { stop(); }
+
+        //! @return The elapsed time, 0 if it's already stopped or there is no counter
+        uint64_t stop()
+        {
+            uint64_t dt = 0;
+
+            if (ns)
+            {
+                dt = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - t0).count());
+                *ns += dt;
+                ns = nullptr;
+            }
+
+            return dt;
+        }
+
+    private:
+        uint64_t* ns;
+        chrono::steady_clock::time_point t0;
+    };
+
+    //! @brief Names the span after the included file
+    void traceInclude(TraceSpan& span, const fs::path& incFile, const char* type, size_t depth)
+    {
+        if (!span.active()) return;
+
+        span.rename(incFile.filename().string());
+        span.arg("path", incFile.string());
+        span.arg("type", string(type));
+        span.arg("depth", static_cast<uint64_t>(depth));
+    }
+
     struct ProcPos
     {
         ProcPos() : ln(0), col(0) {}
@@ -80,37 +140,105 @@ namespace
         size_t col;
     };
 
+    //! @brief Identity of an included file
+    //!
+    //! Device and inode on Unix. Otherwise, and for the files of processBuffer() which don't
+    //! exist in the file system, the normalised path.
+    //!
+    struct IncludeId
+    {
+        IncludeId() : dev(0), ino(0) {}
+
+        uint64_t dev;
+        uint64_t ino;
+        string name;
+
+        bool operator==(const IncludeId& other) const { return ((dev == other.dev) && (ino == other.ino) && (name == other.name)); }
+    };
+
+    struct IncludeIdHash
+    {
+        size_t operator()(const IncludeId& id) const { return hash<uint64_t>()(id.ino ^ (id.dev * 0x9E3779B97F4A7C15ull)) ^ hash<string>()(id.name); }
+    };
+
+    //! @brief Stack of included files
+    //!
+    //! The files are counted by their identity, so contains() is a hash lookup and the file is
+    //! stat'ed at most once through metaCache.
+    //!
     class AbsPathStack
     {
     public:
-        AbsPathStack() { clear(); }
+        AbsPathStack(FileMetaCache* metaCache) : metaCache(metaCache) { clear(); }
         ~AbsPathStack() {}
 
         void clear()
         {
             v.clear();
+            ids.clear();
+            count.clear();
         }
 
-        bool contains(const fs::path& path) const
+        //! @return false if the file does not exist
+        bool id(const fs::path& path, IncludeId& id) const
         {
-            error_code ec;
+            id = IncludeId();
 
-            for (size_t i = 0; i < v.size(); ++i)
+            if (!metaCache)
             {
-                if (fs::equivalent(path, v[i], ec)) return true;
+                id.name = path.lexically_normal().string();
+                return true;
             }
 
-            return false;
+            FileMeta meta;
+            if ((metaCache->get(path, meta) != 0) || !meta.exists) return false;
+
+#if PRJ_PLAT_UNIX
+            id.dev = meta.dev;
+            id.ino = meta.ino;
+#else
+            error_code ec;
+            const fs::path p = fs::weakly_canonical(fs::absolute(path), ec);
+            id.name = (ec ? fs::absolute(path).lexically_normal() : p).string();
+#endif
+
+            return true;
+        }
+
+        bool contains(const IncludeId& id) const
+        {
+            return (count.find(id) != count.end());
+        }
+
+        bool contains(const fs::path& path) const
+        {
+            if (v.empty()) return false;
+
+            IncludeId incId;
+            return (id(path, incId) && contains(incId));
         }
 
         void pop()
         {
+            const auto it = count.find(ids.back());
+            if (--(it->second) == 0) count.erase(it);
+
+            ids.pop_back();
             v.pop_back();
         }
 
+        void push(const fs::path& path, const IncludeId& id)
+        {
+            v.push_back(metaCache ? fs::absolute(path) : path.lexically_normal());
+            ids.push_back(id);
+            ++count[id];
+        }
+
         void push(const fs::path& path)
         {
-            v.push_back(fs::absolute(path));
+            IncludeId incId;
+            id(path, incId);
+            push(path, incId);
         }
 
         size_t size() const
@@ -118,6 +246,21 @@ namespace
             return v.size();
         }
 
+        const fs::path& at(size_t i) const
+        {
+            return v[i];
+        }
+
+        bool containsAny(const vector<fs::path>& paths) const
+        {
+            for (size_t i = 0; i < paths.size(); ++i)
+            {
+                if (contains(paths[i])) return true;
+            }
+
+            return false;
+        }
+
         std::string toString() const
         {
             string s = "";
@@ -132,11 +275,225 @@ namespace
         }
 
     private:
+        FileMetaCache* metaCache;
         vector<fs::path> v;
+        vector<IncludeId> ids;
+        unordered_map<IncludeId, size_t, IncludeIdHash> count; // the history contains files multiple times
+    };
+
+    //! @brief Processed include file
+    struct IncludeCacheEntry
+    {
+        string output;
+        vector<EWIMessage> diag; // printed diagnostics
+        Result r;
+        vector<fs::path> nested; // transitively included files in include order
+        vector<pair<fs::path, FileMeta>> stamps; // the file and its nested includes when they were processed
+    };
+
+    //! @brief Run wide cache of processed include files, shared by all jobs
+    //!
+    //! The entries are keyed by the path of the included file and the job options which
+    //! affect the processing. Thread safe.
+    //!
+    class IncludeCache
+    {
+    public:
+        IncludeCache() {}
+
+        shared_ptr<const IncludeCacheEntry> get(const std::string& key) const
+        {
+            lock_guard<mutex> lock(mtx);
+
+            const auto it = m.find(key);
+            if (it == m.end()) return nullptr;
+            return it->second;
+        }
+
+        void add(const std::string& key, const shared_ptr<const IncludeCacheEntry>& entry)
+        {
+            lock_guard<mutex> lock(mtx);
+            m.emplace(key, entry);
+        }
+
+        //! @brief Removes the entries of the file and of all files which included it
+        void invalidate(const fs::path& file)
+        {
+            const string path = file.lexically_normal().string();
+
+            lock_guard<mutex> lock(mtx);
+
+            for (auto it = m.begin(); it != m.end();)
+            {
+                bool affected = (it->first.compare(0, it->first.find('\n'), path) == 0);
+
+                for (size_t i = 0; !affected && (i < it->second->nested.size()); ++i)
+                {
+                    affected = (it->second->nested[i].lexically_normal().string() == path);
+                }
+
+                if (affected) it = m.erase(it);
+                else ++it;
+            }
+        }
+
+        //! @brief Removes the entries whose file or nested includes changed since they were processed
+        void validate()
+        {
+            vector<pair<string, shared_ptr<const IncludeCacheEntry>>> entries;
+
+            {
+                lock_guard<mutex> lock(mtx);
+                entries.assign(m.begin(), m.end());
+            }
+
+            FileMetaCache metaCache;
+
+            for (size_t i = 0; i < entries.size(); ++i)
+            {
+                const vector<pair<fs::path, FileMeta>>& stamps = entries[i].second->stamps;
+                bool valid = !stamps.empty();
+
+                for (size_t j = 0; valid && (j < stamps.size()); ++j)
+                {
+                    FileMeta meta;
+                    valid = ((metaCache.get(stamps[j].first, meta) == 0) && FileMeta::sameState(meta, stamps[j].second));
+                }
+
+                if (!valid)
+                {
+                    lock_guard<mutex> lock(mtx);
+
+                    const auto it = m.find(entries[i].first);
+                    if ((it != m.end()) && (it->second == entries[i].second)) m.erase(it);
+                }
+            }
+        }
+
+        static std::string key(const fs::path& incFile, const Job& job)
+        {
+            return incFile.lexically_normal().string() + '\n' + job.getTag() + '\n' + (job.warningAsError() ? "Werror" : "") + '\n' + job.wSupListToString();
+        }
+
+    private:
+        mutable mutex mtx;
+        unordered_map<string, shared_ptr<const IncludeCacheEntry>> m;
+    };
+
+    //! @brief How the output file of a job has been written
+    struct JobOutcome
+    {
+        JobOutcome() : copied(false), unchanged(false) {}
+
+        bool copied;    // the input had no directives and was copied by the kernel
+        bool unchanged; // the output file had the right content already and was left untouched
+    };
+
+    //! @brief Included files of processBuffer(), provided by the resolver instead of the file system
+    class MemIncludes
+    {
+    public:
+        MemIncludes(const IncludeResolver& resolver) : resolver(resolver) {}
+
+        //! @return The content of the file, nullptr if it does not exist
+        shared_ptr<const string> get(const fs::path& file)
+        {
+            const string path = file.lexically_normal().string();
+
+            const auto it = files.find(path);
+            if (it != files.end()) return it->second;
+
+            shared_ptr<string> content = make_shared<string>();
+            if (!resolver || !resolver(path, *content)) content.reset();
+
+            files.emplace(path, content);
+
+            return content;
+        }
+
+    private:
+        const IncludeResolver& resolver;
+        unordered_map<string, shared_ptr<const string>> files;
     };
 
-    AbsPathStack incPathStack;
-    AbsPathStack incPathHistory;
+    //! @brief Processing state of one job, shared by all its (nested) included files
+    //!
+    //! The included files are read from the file system, or from memIncludes if it's not nullptr.
+    //!
+    struct ProcContext
+    {
+        ProcContext(IncludeCache& cache, FileMetaCache& metaCache)
+            : incPathStack(&metaCache), incPathHistory(&metaCache), cache(cache), metaCache(&metaCache), memIncludes(nullptr), nCtxDependent(0), stats(nullptr), bufferSize(0)
+        {}
+
+        ProcContext(IncludeCache& cache, MemIncludes& memIncludes)
+            : incPathStack(nullptr), incPathHistory(nullptr), cache(cache), metaCache(nullptr), memIncludes(&memIncludes), nCtxDependent(0), stats(nullptr), bufferSize(0)
+        {}
+
+        bool exists(const fs::path& file)
+        {
+            if (memIncludes) return (memIncludes->get(file) != nullptr);
+
+            FileMeta meta;
+            return ((metaCache->get(file, meta) == 0) && meta.exists);
+        }
+
+        AbsPathStack incPathStack;
+        AbsPathStack incPathHistory;
+
+        IncludeCache& cache;
+        FileMetaCache* metaCache;
+        MemIncludes* memIncludes;
+
+        //! @brief Number of include directives whose result depended on the include stack or history
+        size_t nCtxDependent;
+
+        JobOutcome outcome;
+
+        //! @brief Statistics of the job, nullptr if they are not collected
+        JobStats* stats;
+
+        //! @brief Statistics of the included file, only call if stats is not nullptr
+        IncludeStats& includeStats(const fs::path& file)
+        {
+            const auto it = includeStatsIdx.emplace(file.string(), stats->includes.size());
+
+            if (it.second)
+            {
+                stats->includes.push_back(IncludeStats());
+                stats->includes.back().file = file;
+            }
+
+            return stats->includes[it.first->second];
+        }
+
+        void directive(Keyword kw)
+        {
+            if (!stats) return;
+
+            if (kw == Keyword::rmStart) ++stats->nRm;
+            else if (kw == Keyword::rmEnd) ++stats->nEndrm;
+            else if (kw == Keyword::rmn) ++stats->nRmn;
+            else if (kw == Keyword::ins) ++stats->nIns;
+            else if (kw == Keyword::include) ++stats->nInclude;
+        }
+
+        //! @brief Data of this size is held until bufferRelease()
+        void bufferAcquire(size_t size)
+        {
+            bufferSize += size;
+            if (stats && (bufferSize > stats->peakBufferSize)) stats->peakBufferSize = bufferSize;
+        }
+
+        void bufferRelease(size_t size)
+        {
+            bufferSize -= size;
+        }
+
+    private:
+        unordered_map<string, size_t> includeStatsIdx;
+        size_t bufferSize;
+    };
 
     void printError(const std::string& file, const std::string& text, size_t line = 0, size_t col = 0)
     {
@@ -147,15 +504,6 @@ namespace
         printError(file, text, procPos.ln, procPos.col);
     }
 
-    void printWarning(const std::string& file, const std::string& text, size_t line = 0, size_t col = 0)
-    {
-        printEWI(file, text, line, col, 1, 1);
-    }
-    void printWarning(const std::string& file, const std::string& text, const ProcPos& procPos)
-    {
-        printWarning(file, text, procPos.ln, procPos.col);
-    }
-
     void printInfo(const std::string& file, const std::string& text, size_t line = 0, size_t col = 0)
     {
         printEWI(file, text, line, col, 2, 1);
@@ -183,12 +531,49 @@ namespace
         if (!vectorContains(job.getWSupList(), wID))
         {
             ++r.warn;
-            printWarning(file, msg + " [" + to_string(wID) + "]", procPos);
+            printEWI(EWIMessage(file, msg, procPos.ln, procPos.col, 1, 1, wID));
         }
 
         return r;
     }
 
+    string lineEndingName(lineEnding le)
+    {
+        if (le == lineEnding::CR) return "CR";
+        if (le == lineEnding::CRLF) return "CRLF";
+        return "LF";
+    }
+
+    //! @brief Checks the UTF BOM
+    //! @return Name of the encoding if it is not supported, otherwise nullptr
+    //!
+    //! UTF-8 BOM is copied like every other UTF-8 byte.
+    //!
+    const char* unsupportedEncoding(const char* pb, size_t size)
+    {
+        if (size >= 4)
+        {
+            if (pb[0] == static_cast<char>(0x00) && pb[1] == static_cast<char>(0x00) &&
+                pb[2] == static_cast<char>(0xFe) && pb[3] == static_cast<char>(0xFF))
+            {
+                return "UTF-32 BE";
+            }
+            if (pb[0] == static_cast<char>(0xFF) && pb[1] == static_cast<char>(0xFe) &&
+                pb[2] == static_cast<char>(0x00) && pb[3] == static_cast<char>(0x00))
+            {
+                return "UTF-32 LE";
+            }
+        }
+
+        if (size >= 2)
+        {
+            if (pb[0] == static_cast<char>(0xFe) && pb[1] == static_cast<char>(0xFF)) return "UTF-16 BE";
+            if (pb[0] == static_cast<char>(0xFF) && pb[1] == static_cast<char>(0xFe)) return "UTF-16 LE";
+        }
+
+        return nullptr;
+    }
+
     //! @brief Checks if *p is space
     bool isSpace(const char* p)
     {
@@ -213,20 +598,49 @@ namespace
             );
     }
 
-    Keyword getKW(const string& kwStr)
+    //! @brief Selects the candidate by the length and the first character, so it's one compare at most
+    Keyword getKW(string_view kwStr)
     {
         Keyword kw = Keyword::unknown;
 
-        if (kwStr.compare(keyword_rmStart) == 0) kw = Keyword::rmStart;
-        if (kwStr.compare(keyword_rmEnd) == 0) kw = Keyword::rmEnd;
-        if (kwStr.compare(keyword_rmn) == 0)  kw = Keyword::rmn;
-        if (kwStr.compare(keyword_ins) == 0) kw = Keyword::ins;
-        if (kwStr.compare(keyword_include) == 0) kw = Keyword::include;
-        //if (kwStr.compare(keyord_) == 0) kw = Keyword::;
+        switch (kwStr.length())
+        {
+        case keyword_rmStart.length():
+            if (kwStr == keyword_rmStart) kw = Keyword::rmStart;
+            break;
+
+        case keyword_rmEnd.length():
+            if (kwStr == keyword_rmEnd) kw = Keyword::rmEnd;
+            break;
+
+        case keyword_rmn.length(): // == keyword_ins.length()
+            if ((kwStr[0] == keyword_rmn[0]) && (kwStr == keyword_rmn)) kw = Keyword::rmn;
+            else if ((kwStr[0] == keyword_ins[0]) && (kwStr == keyword_ins)) kw = Keyword::ins;
+            break;
+
+        case keyword_include.length():
+            if (kwStr == keyword_include) kw = Keyword::include;
+            break;
+
+        default:
+            break;
+        }
 
         return kw;
     }
 
+    //! @brief Returns the token starting at p, which ends at the next white space or the end of the data
+    string_view nextToken(const char*& p, const char* pMax, ProcPos& pPos)
+    {
+        const char* const begin = p;
+
+        while ((p < pMax) && !isWhiteSpace(p)) ++p;
+
+        pPos.col += static_cast<size_t>(p - begin);
+
+        return string_view(begin, static_cast<size_t>(p - begin));
+    }
+
     Result rmOut(const fs::path& outf, const string& ewiFile, const Job& job, bool dir) noexcept
     {
         Result r;
@@ -251,7 +665,13 @@ namespace
         {
             const string rmDirErrorMsg = "temporary output directory not deleted";
 
-            try { fs::remove(outf.parent_path()); }
+            try
+            {
+                // the directory may have been populated by jobs running in parallel
+                error_code ec;
+                fs::remove(outf.parent_path(), ec);
+                if (ec && (ec != errc::directory_not_empty)) throw fs::filesystem_error("cannot remove", outf.parent_path(), ec);
+            }
             catch (fs::filesystem_error& ex)
             {
                 r += warn(ewiFile, wID_rmOut_dir, job, rmDirErrorMsg + ": " + ex.what());
@@ -278,764 +698,1732 @@ namespace
         return 0;
     }
 
-    Result includeDirtyProc(ofstream& outFileStream, const fs::path& incFile, const Job& job, const string& ewiFile, const ProcPos& pPos, size_t pathCol)
+    //! @brief Result and buffered diagnostics of a job processed by a worker thread
+    struct JobSlot
     {
-        Result r;
+        JobSlot() : done(false) {}
 
-        ofstream& ofs = outFileStream;
-        ifstream ifs;
-
-        ifs.open(incFile, ios::in | ios::binary);
+        ostringstream diag;
+        Result r;
+        JobOutcome outcome;
+        bool done;
+    };
 
-        char c = static_cast<char>(ifs.get());
+    //! @brief Groups the jobs which have to run one after the other
+    //! @return The indices of the jobs of each group in jobfile order, the groups are ordered by their first job
+    //!
+    //! Jobs writing the same output file are in the same group, as well as a job reading or
+    //! writing the output or the input of an earlier job. A failed job removes the output
+    //! directory it created, so jobs writing to a directory which does not exist yet are grouped
+    //! by the topmost missing directory. Jobs of different groups don't touch the files of each
+    //! other (apart from included files) and can run in parallel.
+    //!
+    vector<vector<size_t>> jobGroups(const vector<Job>& jobs)
+    {
+        vector<size_t> parent(jobs.size());
+        for (size_t i = 0; i < parent.size(); ++i) parent[i] = i;
 
-        if (!ifs.good())
+        const auto root = [&parent](size_t i)
         {
-            r += warn(ewiFile, wID_include_emptyFile, job, "empty include file", ProcPos(pPos.ln, pathCol));
-        }
+            while (parent[i] != i) i = parent[i] = parent[parent[i]];
+            return i;
+        };
 
-        while (ifs.good())
+        // the earlier job is the root, so a group is ordered by its root
+        const auto unite = [&parent, &root](size_t a, size_t b)
         {
-            ofs.put(c);
-            c = static_cast<char>(ifs.get());
-        }
+            a = root(a);
+            b = root(b);
+            if (a < b) parent[b] = a;
+            else if (b < a) parent[a] = b;
+        };
+
+        unordered_map<string, size_t> outputs; // first job writing the file
+        unordered_map<string, size_t> inputs; // first job reading the file
+        unordered_map<string, size_t> newDirs; // first job creating the directory
+        unordered_map<string, bool> dirExists;
+
+        // topmost missing directory of the file, empty if its directory exists
+        const auto newDir = [&dirExists](const fs::path& file)
+        {
+            fs::path top;
 
-        return r;
-    }
+            for (fs::path dir = file.parent_path(); !dir.empty(); dir = dir.parent_path())
+            {
+                const auto it = dirExists.find(dir.string());
+                bool exists;
 
-    Result includeDirty(ofstream& outFileStream, const fs::path& incFile, const fs::path& outf, const Job& job, const string& ewiFile, const ProcPos& pPos, size_t pathCol)
-    {
-        Result r;
+                if (it != dirExists.end()) exists = it->second;
+                else
+                {
+                    error_code ec;
+                    exists = fs::exists(dir, ec);
+                    dirExists.emplace(dir.string(), exists);
+                }
 
-        lineEnding ile = detectLineEnding(incFile);
+                if (exists) break;
 
-        if (ile == lineEnding::error)
-        {
-            r += warn(ewiFile, wID_endlAssumeLF, job, "Unable to determine line ending, assuming LF");
-            ile = lineEnding::LF;
-        }
+                top = dir;
+                if (dir == dir.parent_path()) break;
+            }
 
-        if (ile == lineEnding::LF) r += includeDirtyProc(outFileStream, incFile, job, ewiFile, pPos, pathCol);
-        else
-        {
-            const fs::path tmpProcDir(outf.parent_path() / processorTmpDirLineEnding);
-            const fs::path incfLF(tmpProcDir / (incFile.filename().string() + ".incfLF"));
+            return top.string();
+        };
 
-            fs::create_directories(tmpProcDir);
+        for (size_t i = 0; i < jobs.size(); ++i)
+        {
+            if (!jobs[i].isValid()) continue;
 
-            string errMsg;
-            bool deleteTmpProcDir = true;
+            string in, out, dir;
 
-            if (convertLineEnding(incFile, ile, incfLF, lineEnding::LF, errMsg) == 0)
+            try
             {
-                r += includeDirtyProc(outFileStream, incfLF, job, ewiFile, pPos, pathCol);
+                const fs::path outPath = jobs[i].getOutputPath().lexically_normal();
 
-                if (r.err != 0) deleteTmpProcDir = false;
+                in = jobs[i].getInputPath().lexically_normal().string();
+                out = outPath.string();
+                dir = newDir(outPath);
             }
-            else
+            catch (...) { continue; } // fails in runJob() too
+
+            if (!dir.empty())
             {
-                ++r.err;
-                printError(ewiFile, "convert line ending of include file failed" + (errMsg.length() > 0 ? (" - " + errMsg) : ""), ProcPos(pPos.ln, pathCol));
+                const auto dirIt = newDirs.find(dir);
+                if (dirIt != newDirs.end()) unite(dirIt->second, i);
+                else newDirs.emplace(dir, i);
             }
 
-            if (deleteTmpProcDir) fs::remove_all(tmpProcDir);
-        }
-
-        return r;
-    }
+            const auto outIt = outputs.find(out);
+            if (outIt != outputs.end()) unite(outIt->second, i);
+            else outputs.emplace(out, i);
 
-    Result includeRel(ofstream& outFileStream, const fs::path& incFile, const fs::path& outf, const Job& job, const string& ewiFile, const ProcPos& pPos, size_t pathCol)
-    {
-        Result r;
+            const auto inOfOut = inputs.find(out);
+            if (inOfOut != inputs.end()) unite(inOfOut->second, i);
 
-        ofstream& ofs = outFileStream;
+            const auto outOfIn = outputs.find(in);
+            if (outOfIn != outputs.end()) unite(outOfIn->second, i);
 
-        fs::path incOutf = outf.parent_path() / processorTmpDirIncOut / incFile.filename();
-        Job tmpJob = job;
-        tmpJob.setInputFile(incFile.string());
-        tmpJob.setOutputFile(incOutf.string());
+            inputs.emplace(in, i);
+        }
 
-        const fs::path currentWD = fs::current_path();
-        string cwdExWhat;
-        Result cwdr = changeWD(incFile.parent_path(), &cwdExWhat);
+        vector<vector<size_t>> groups;
+        vector<size_t> groupIdx(jobs.size());
 
-        if (cwdr > 0)
-        {
-            ++r.err;
-            printError(ewiFile, "could not change working dir to process included file: " + cwdExWhat);
-        }
-        else
+        for (size_t i = 0; i < jobs.size(); ++i)
         {
-            Result recoursiveResult = processJob(tmpJob, true);
-            r += recoursiveResult;
+            const size_t r = root(i);
 
-            cwdr = changeWD(currentWD, &cwdExWhat);
-            if (cwdr > 0)
+            if (r == i)
             {
-                ++r.err;
-                printError(ewiFile, "could not change back to working dir after processing included file: " + cwdExWhat);
+                groupIdx[i] = groups.size();
+                groups.push_back(vector<size_t>());
             }
 
-            if ((recoursiveResult.err == 0) && (cwdr == 0))
-            {
-                r += includeDirty(ofs, incOutf, outf, job, ewiFile, pPos, pathCol);
-                r += rmOut(incOutf, ewiFile, job, true);
-            }
+            groups[groupIdx[r]].push_back(i);
         }
 
-        return r;
+        return groups;
     }
 
+    //! @brief Output of the processor
+    //!
+    //! Collects references to the pieces of the output instead of copying them. Unchanged lines
+    //! refer to the input buffer, which has to stay valid until the output is written, and
+    //! included files to their include cache entry, which is kept alive. Only data which does
+    //! not outlive the directive is copied. Contiguous pieces are merged, so long runs without
+    //! directives end up as one span.
+    //!
+    class ProcOutput
+    {
+    public:
+        ProcOutput() : n(0) {}
 
+        void write(const char* data, size_t count)
+        {
+            if (count == 0) return;
 
+            if (!spans.empty() && ((spans.back().data + spans.back().size) == data)) spans.back().size += count;
+            else spans.push_back({ data, count });
 
+            n += count;
+        }
 
-
-
-#if PRJ_DEBUG && 0
-    const size_t pbSizeMin = 200;
-#else
-    const size_t pbSizeMin = 100 * 1024; // 100k
-#endif
-
-    typedef char fileIOt;
-    //typedef uint8_t fileIOt;
-
-
-    //! @brief Reads some bytes from the input file
-    //! @param ifs 
-    //! @param [out] data 
-    //! @return Number of read bytes
-    //! 
-    //! Aligned to new lines and thus does neither chop UTF-8 chunks nor tags.
-    //! 
-    size_t readsome(ifstream& ifs, vector<fileIOt>& data)
-    {
-        size_t nRead = 0;
-
-        try
+        void write(const shared_ptr<const IncludeCacheEntry>& entry)
         {
-            data.push_back(static_cast<fileIOt>(ifs.get()));
-            ++nRead;
+            if (!entry->output.empty())
+            {
+                entries.push_back(entry);
+                write(entry->output.data(), entry->output.size());
+            }
         }
-        catch (...) { return 0; }
 
-        while (
-            (nRead < pbSizeMin) ||
-            (data.at(data.size() - 1) != static_cast<fileIOt>(0x0A))
-            )
+        void writeCopy(const char* data, size_t count)
         {
-            try { data.push_back(static_cast<fileIOt>(ifs.get())); }
-            catch (...) { break; }
+            if (count > 0)
+            {
+                owned.emplace_back(data, count);
+                write(owned.back().data(), owned.back().size());
+            }
+        }
 
-            ++nRead;
+        //! @brief Number of bytes written so far
+        size_t size() const
+        {
+            return n;
         }
 
-        return nRead;
+        string str() const
+        {
+            string r;
+            r.reserve(n);
+            for (size_t i = 0; i < spans.size(); ++i) r.append(spans[i].data, spans[i].size);
+            return r;
+        }
+
+        //! @brief Writes the output to the file
+        //! @param file
+        //! @param le The processor works on LF, it is converted to this line ending
+        //! @param [out] errMsg
+        //! @param [out] nWritten Number of bytes written, may be nullptr
+        //! @return 0 on success
+        int writeTo(OutputFile& file, lineEnding le, string& errMsg, uint64_t* nWritten = nullptr) const
+        {
+            if ((le != lineEnding::CR) && (le != lineEnding::CRLF))
+            {
+                if (nWritten) *nWritten = n;
+                return file.write(spans.data(), spans.size(), errMsg);
+            }
+
+            uint64_t cnt = 0;
+            const int res = forEachBlock(le, [&file, &errMsg, &cnt](const char* p, size_t count) { cnt += count; return (file.write(p, count, errMsg) == 0); });
+            if (nWritten) *nWritten = cnt;
+            if (res == 1) errMsg = "convert line ending failed";
+
+            return ((res == 0) ? 0 : 1);
+        }
+
+        //! @brief Passes the output to the sink
+        //! @param sink
+        //! @param le The processor works on LF, it is converted to this line ending
+        //! @return 0 on success
+        int writeTo(const OutputSink& sink, lineEnding le) const
+        {
+            return forEachBlock(le, [&sink](const char* p, size_t count) { sink(p, count); return true; });
+        }
+
+        //! @brief Compares the output, converted to the line ending le, with data
+        bool equals(const char* data, size_t size, lineEnding le) const
+        {
+            const bool convert = ((le == lineEnding::CR) || (le == lineEnding::CRLF));
+            if (!convert && (n != size)) return false;
+
+            size_t pos = 0;
+
+            const int res = forEachBlock(le, [data, size, &pos](const char* p, size_t count)
+                {
+                    if ((count > (size - pos)) || (memcmp(data + pos, p, count) != 0)) return false;
+                    pos += count;
+                    return true;
+                });
+
+            return ((res == 0) && (pos == size));
+        }
+
+    private:
+        vector<OutputSpan> spans;
+        vector<shared_ptr<const IncludeCacheEntry>> entries;
+        list<string> owned; // list, so the data of the strings never moves
+        size_t n;
+
+        //! @brief Passes the output in pieces to f, converted to the line ending le
+        //! @return 0 on success, 1 if the conversion failed, 2 if f returned false
+        //!
+        //! LF output is passed span by span, converted pieces are collected in blocks.
+        //!
+        template <class F>
+        int forEachBlock(lineEnding le, F f) const
+        {
+            if ((le != lineEnding::CR) && (le != lineEnding::CRLF))
+            {
+                for (size_t i = 0; i < spans.size(); ++i)
+                {
+                    if (!f(spans[i].data, spans[i].size)) return 2;
+                }
+
+                return 0;
+            }
+
+            const size_t blockSize = 256 * 1024;
+            vector<char> block;
+            vector<char> conv;
+
+            for (size_t i = 0; i < spans.size(); ++i)
+            {
+                if (convertLineEnding(spans[i].data, spans[i].size, lineEnding::LF, conv, le) != 0) return 1;
+
+                block.insert(block.end(), conv.begin(), conv.end());
+
+                if ((block.size() >= blockSize) || ((i + 1) == spans.size()))
+                {
+                    if (!f(block.data(), block.size())) return 2;
+                    block.clear();
+                }
+            }
+
+            return 0;
+        }
+    };
+
+    Result caterpillarProc(ProcContext& ctx, ProcOutput& out, const char* data, size_t size, const fs::path& inf, const Job& job, const string& ewiFile);
+
+    //! @brief Reads an include file and converts its line ending to LF
+    //! @param ctx
+    //! @param incFile
+    //! @param [out] ifile
+    //! @param [out] memFile Holds the data if it's provided by ctx.memIncludes
+    //! @param [out] convBuff Holds the data if it had to be converted
+    //! @param [out] data
+    //! @param [out] size
+    //! @param ewiFile File name used in the diagnostics of the including file
+    //! @param pPos
+    //! @param pathCol
+    Result readIncludeFile(ProcContext& ctx, const fs::path& incFile, InputFile& ifile, shared_ptr<const string>& memFile, vector<char>& convBuff, const char*& data, size_t& size, const string& ewiFile, const ProcPos& pPos, size_t pathCol)
+    {
+        Result r;
+
+        string errMsg;
+        const char* fileData;
+        size_t fileSize;
+
+        if (ctx.memIncludes)
+        {
+            memFile = ctx.memIncludes->get(incFile);
+
+            if (!memFile)
+            {
+                ++r.err;
+                printError(ewiFile, "could not read include file", ProcPos(pPos.ln, pathCol));
+                return r;
+            }
+
+            fileData = memFile->data();
+            fileSize = memFile->size();
+        }
+        else if (ifile.open(incFile, errMsg) != 0)
+        {
+            ++r.err;
+            printError(ewiFile, "could not read include file - " + errMsg, ProcPos(pPos.ln, pathCol));
+            return r;
+        }
+        else
+        {
+            fileData = ifile.data();
+            fileSize = ifile.size();
+        }
+
+        if (ctx.stats)
+        {
+            ctx.stats->bytesIn += fileSize;
+            ctx.includeStats(incFile).bytesRead += fileSize;
+        }
+
+        LineEndingInfo leInfo;
+        const lineEnding ile = detectLineEnding(fileData, fileSize, leInfo);
+
+        if (ile == lineEnding::LF)
+        {
+            data = fileData;
+            size = fileSize;
+        }
+        else if (convertLineEnding(fileData, fileSize, ile, convBuff, lineEnding::LF) == 0)
+        {
+            data = convBuff.data();
+            size = convBuff.size();
+        }
+        else
+        {
+            ++r.err;
+            printError(ewiFile, "convert line ending of include file failed", ProcPos(pPos.ln, pathCol));
+        }
+
+        return r;
     }
 
-    // should not throw explicitly because then the out file does not get deleted.
-    // expects LF files
-    Result caterpillarProc(const fs::path& inf, const fs::path& outf, const Job& job, const string& ewiFile)
+    Result includeDirty(ProcContext& ctx, ProcOutput& out, const fs::path& incFile, const Job& job, const string& ewiFile, const ProcPos& pPos, size_t pathCol)
     {
         Result r;
 
-        vector<fileIOt> procBuff;
-        vector<fileIOt> outBuff;
+        TraceSpan span("include", "include");
+        traceInclude(span, incFile, "dirty", ctx.incPathStack.size());
 
-        const string tag = job.getTag() + " ";
+        InputFile ifile;
+        shared_ptr<const string> memFile;
+        vector<char> convBuff;
+        const char* data = nullptr;
+        size_t size = 0;
 
-        ProcPos pPos(0, 1); // 0 to detect first read
-                            // processed line/column used to display error, threrefore starting with 1
+        r += readIncludeFile(ctx, incFile, ifile, memFile, convBuff, data, size, ewiFile, pPos, pathCol);
 
-        bool eof = false;
-        bool skipThisLine = false;
-        bool proc_rm = false;
-        ProcPos proc_rm_startPos;
-        size_t proc_rmn = 0;
+        if (r.err == 0)
+        {
+            if (size == 0) r += warn(ewiFile, wID_include_emptyFile, job, "empty include file", ProcPos(pPos.ln, pathCol));
+            else out.writeCopy(data, size);
 
-        ifstream ifs;
-        ofstream ofs;
+            // the copy is held by the output
+            ctx.bufferAcquire(size);
+        }
 
-        ifs.exceptions(ios::failbit | ios::badbit | ios::eofbit);
-        ofs.exceptions(ios::failbit | ios::badbit | ios::eofbit);
+        return r;
+    }
+
+    //! @brief Processes the included file recursively into the output of the including file
+    //!
+    //! The result is taken from the include cache if the file has already been processed with the
+    //! same options and none of its nested includes is on the include stack or in the include
+    //! history of this job, otherwise the cached result would lack the loop or multi include
+    //! diagnostics.
+    //!
+    Result includeRel(ProcContext& ctx, ProcOutput& out, const fs::path& incFile, const Job& job, const string& ewiFile, const ProcPos& pPos, size_t pathCol)
+    {
+        Result r;
 
-        ifs.open(inf, ios::in | ios::binary);
-        ofs.open(outf, ios::out | ios::binary);
+        TraceSpan span("include", "include");
+        traceInclude(span, incFile, "rel", ctx.incPathStack.size());
 
-        while (!eof)
+        const string cacheKey = IncludeCache::key(incFile, job);
+        shared_ptr<const IncludeCacheEntry> entry = ctx.cache.get(cacheKey);
+
+        if (entry && !ctx.incPathStack.containsAny(entry->nested) && !ctx.incPathHistory.containsAny(entry->nested))
         {
-            procBuff.clear();
-            size_t nRead = readsome(ifs, procBuff);
-            const fileIOt* const pb = procBuff.data();
-            const fileIOt* const pMax = pb + nRead;
-            const fileIOt* p = pb;
+            if (ctx.stats) ++ctx.includeStats(incFile).nCached;
+            span.arg("cached", 1);
+
+            for (size_t i = 0; i < entry->diag.size(); ++i) printEWI(entry->diag[i]);
+            out.write(entry);
+
+            for (size_t i = 0; i < entry->nested.size(); ++i) ctx.incPathHistory.push(entry->nested[i]);
+
+            r = entry->r;
+        }
+        else
+        {
+            string incEwiFile;
+            try { incEwiFile = incFile.filename().string(); }
+            catch (...) { incEwiFile = incFile.string(); }
+
+            shared_ptr<IncludeCacheEntry> newEntry = make_shared<IncludeCacheEntry>();
+            ProcOutput incOut;
+
+            const size_t historySize = ctx.incPathHistory.size();
+            const size_t nCtxDependent = ctx.nCtxDependent;
 
-            if ((nRead < pbSizeMin) || ifs.eof()) eof = true;
+            vector<EWIMessage>* const parentEwiCapture = ewiCapture();
+            setEwiCapture(&newEntry->diag);
 
-            // only on first read
-            if (pPos.ln == 0)
+            InputFile ifile;
+            shared_ptr<const string> memFile;
+            vector<char> convBuff;
+            const char* data = nullptr;
+            size_t size = 0;
+
+            r += readIncludeFile(ctx, incFile, ifile, memFile, convBuff, data, size, ewiFile, pPos, pathCol);
+
+            const bool readOk = (r.err == 0);
+            const size_t held = ifile.size() + (memFile ? memFile->size() : 0) + convBuff.size();
+
+            if (readOk)
             {
-                pPos.ln = 1;
+                ctx.bufferAcquire(held);
+                r += caterpillarProc(ctx, incOut, data, size, incFile, job, incEwiFile);
+                ctx.bufferRelease(held);
 
-                // UTF BOM check
-                if (procBuff.size() >= 4)
+                if (job.warningAsError() && (r.warn > 0))
                 {
-                    if (procBuff[0] == static_cast<fileIOt>(0x00) && procBuff[1] == static_cast<fileIOt>(0x00) &&
-                        procBuff[2] == static_cast<fileIOt>(0xFe) && procBuff[3] == static_cast<fileIOt>(0xFF))
-                    {
-                        printError(ewiFile, "encoding not supported: UTF-32 BE");
-                        return 1;
-                    }
-                    if (procBuff[0] == static_cast<fileIOt>(0xFF) && procBuff[1] == static_cast<fileIOt>(0xFe) &&
-                        procBuff[2] == static_cast<fileIOt>(0x00) && procBuff[3] == static_cast<fileIOt>(0x00))
-                    {
-                        printError(ewiFile, "encoding not supported: UTF-32 LE");
-                        return 1;
-                    }
+                    ++r.err;
+                    printError(incEwiFile, "###[@Werror@] " + to_string(r.warn) + " warnings");
                 }
+            }
+
+            setEwiCapture(parentEwiCapture);
+
+            newEntry->output = incOut.str();
+            newEntry->r = r;
+            ctx.bufferAcquire(newEntry->output.size()); // held by the output
+            for (size_t i = historySize; i < ctx.incPathHistory.size(); ++i) newEntry->nested.push_back(ctx.incPathHistory.at(i));
+
+            // stat'ed before they were read, a change while reading invalidates the entry later
+            for (size_t i = 0; ctx.metaCache && (i <= newEntry->nested.size()); ++i)
+            {
+                const fs::path& file = ((i == 0) ? incFile : newEntry->nested[i - 1]);
+                FileMeta meta;
 
-                if (procBuff.size() >= 2)
+                if (ctx.metaCache->get(file, meta) == 0) newEntry->stamps.push_back(make_pair(file, meta));
+            }
+
+            for (size_t i = 0; i < newEntry->diag.size(); ++i) printEWI(newEntry->diag[i]);
+            out.write(newEntry);
+
+            // errors of reading the file are reported at the include directive of the including file
+            if (readOk && (ctx.nCtxDependent == nCtxDependent)) ctx.cache.add(cacheKey, newEntry);
+
+            entry = newEntry;
+        }
+
+        if ((r.err == 0) && entry->output.empty())
+        {
+            r += warn(ewiFile, wID_include_emptyFile, job, "empty include file", ProcPos(pPos.ln, pathCol));
+        }
+
+        return r;
+    }
+
+
+
+    //! @brief Copies the file, inside of the kernel if possible
+    //! @param inf
+    //! @param outf
+    //! @param ifile The input file if it is already open, may be nullptr
+    //! @param replace Replace the output file atomically, see OutputFile::openReplace()
+    //! @param [out] errMsg
+    //! @return 0 on success
+    int copyFile(const fs::path& inf, const fs::path& outf, const InputFile* ifile, bool replace, string& errMsg)
+    {
+        OutputFile ofile;
+
+        int res = (replace ? ofile.openReplace(outf, errMsg) : ofile.open(outf, errMsg));
+
+        if (res == 0)
+        {
+            res = ofile.copyFrom(inf, errMsg);
+
+            if (res == 2)
+            {
+                InputFile inputFile;
+
+                if (!ifile)
                 {
-                    if (procBuff[0] == static_cast<fileIOt>(0xFe) && procBuff[1] == static_cast<fileIOt>(0xFF))
-                    {
-                        printError(ewiFile, "encoding not supported: UTF-16 BE");
-                        return 1;
-                    }
-                    if (procBuff[0] == static_cast<fileIOt>(0xFF) && procBuff[1] == static_cast<fileIOt>(0xFe))
-                    {
-                        printError(ewiFile, "encoding not supported: UTF-16 LE");
-                        return 1;
-                    }
+                    res = inputFile.open(inf, errMsg);
+                    ifile = &inputFile;
                 }
+                else res = 0;
 
-                // UTF-8 BOM is copied like every other UTF-8 byte
+                if (res == 0) res = ofile.write(ifile->data(), ifile->size(), errMsg);
             }
+        }
+
+        if (res == 0) res = ofile.close(errMsg);
+        else ofile.discard();
+
+        return res;
+    }
+
+    //! @brief Checks if the file has the content data
+    bool equalContent(const fs::path& file, const FileMeta& meta, const char* data, size_t size)
+    {
+        if (!meta.regular || (meta.size != size)) return false;
+
+        InputFile ifile;
+
+        if (ifile.open(file) != 0) return false;
+
+        return ((ifile.size() == size) && ((size == 0) || (memcmp(ifile.data(), data, size) == 0)));
+    }
+
+    //! @brief Checks if both files have the same content
+    //!
+    //! Files of different size are not read.
+    //!
+    bool equalContent(const fs::path& a, const FileMeta& metaA, const fs::path& b, const FileMeta& metaB)
+    {
+        if (!metaA.regular || !metaB.regular || (metaA.size != metaB.size)) return false;
+
+        InputFile fileA, fileB;
+
+        if ((fileA.open(a) != 0) || (fileB.open(b) != 0)) return false;
+        if (fileA.size() != fileB.size()) return false;
+
+        return ((fileA.size() == 0) || (memcmp(fileA.data(), fileB.data(), fileA.size()) == 0));
+    }
+
+    //! @brief Processes a buffer
+    //! @param ctx
+    //! @param out
+    //! @param data
+    //! @param size
+    //! @param srcFile Absolute path of the file containing the data, relative include paths are based on it
+    //! @param job
+    //! @param ewiFile
+    //!
+    //! Expects LF line endings.
+    //!
+    Result caterpillarProc(ProcContext& ctx, ProcOutput& out, const char* data, size_t size, const fs::path& srcFile, const Job& job, const string& ewiFile)
+    {
+        Result r;
+
+        const string tag = job.getTag() + " ";
+
+        ProcPos pPos(1, 1); // processed line/column used to display error, threrefore starting with 1
+
+        bool skipThisLine = false;
+        bool proc_rm = false;
+        ProcPos proc_rm_startPos;
+        size_t proc_rmn = 0;
 
+        const char* const pb = data;
+        const char* const pMax = pb + size;
+        const char* p = pb;
 
+        const char* const encoding = unsupportedEncoding(pb, size);
 
+        if (encoding)
+        {
+            printError(ewiFile, "encoding not supported: " + string(encoding));
+            return 1;
+        }
 
 
 
-            // process
-            while (p < pMax)
+        // process
+        while (p < pMax)
+        {
+            // Jump to the next line containing a tag. The lines in between are copied as one
+            // block, or dropped inside of rm scopes. rmn scopes are handled line by line below.
+            if (proc_rmn == 0)
             {
-                outBuff.clear();
+                const char* const tagLine = scanFindTagLine(p, pMax, tag.c_str(), tag.length());
 
-                // copy whitespace
-                while ((p < pMax) && isSpace(p))
+                if (tagLine > p)
                 {
-                    outBuff.push_back(*p);
-                    ++p;
-                    ++pPos.col;
+                    if (!proc_rm) out.write(p, tagLine - p);
+
+                    pPos.ln += scanCountChar(p, tagLine, 0x0A);
+                    if ((tagLine == pMax) && !isNewLine(pMax - 1)) ++pPos.ln; // last line without LF
+
+                    p = tagLine;
+
+                    if (p >= pMax) break;
                 }
+            }
 
+            const char* const lineBegin = p;
 
-                // tag?
-                if (p < (pMax - tag.length()))
+            // whitespace is copied
+            while ((p < pMax) && isSpace(p))
+            {
+                ++p;
+                ++pPos.col;
+            }
+
+            const char* const wsEnd = p;
+            const char* restBegin = p;
+
+
+            // tag?
+            if (static_cast<size_t>(pMax - p) > tag.length())
+            {
+                if (memcmp(p, tag.c_str(), tag.length()) == 0)
                 {
-                    if (tag.compare(0, tag.length(), p, tag.length()) == 0)
-                    {
-                        // yes, tag
+                    // yes, tag
 
-                        const size_t tagCol = pPos.col;
+                    const size_t tagCol = pPos.col;
 
-                        p += tag.length();
-                        pPos.col += tag.length();
+                    p += tag.length();
+                    pPos.col += tag.length();
 
 
-                        // skip space
-                        while ((p < pMax) && isSpace(p))
-                        {
-                            ++p;
-                            ++pPos.col;
-                        }
+                    // skip space
+                    while ((p < pMax) && isSpace(p))
+                    {
+                        ++p;
+                        ++pPos.col;
+                    }
 
 
-                        const size_t kwCol = pPos.col;
+                    const size_t kwCol = pPos.col;
 
-                        // determine keyword
-                        string kwStr = "";
+                    // determine keyword
+                    const string_view kwStr = nextToken(p, pMax, pPos);
 
-                        while ((p < pMax) && !isWhiteSpace(p))
-                        {
-                            kwStr += *p;
-                            ++p;
-                            ++pPos.col;
-                        }
+                    Keyword kw = getKW(kwStr);
+                    ctx.directive(kw);
 
-                        Keyword kw = getKW(kwStr);
 
+                    if ((proc_rm && (kw != Keyword::rmEnd)) || proc_rmn)
+                    {
+                        r += warn(ewiFile, wID_tagInRMx, job, "###tags inside @rm@ or @rmn@ scopes are ignored", ProcPos(pPos.ln, tagCol));
+                    }
+                    else
+                    {
 
-                        if ((proc_rm && (kw != Keyword::rmEnd)) || proc_rmn)
+                        // process keywords
+                        if (kw == Keyword::rmStart)
                         {
-                            r += warn(ewiFile, wID_tagInRMx, job, "###tags inside @rm@ or @rmn@ scopes are ignored", ProcPos(pPos.ln, tagCol));
+                            proc_rm = true;
                         }
-                        else
+                        else if (kw == Keyword::rmEnd)
                         {
-
-                            // process keywords
-                            if (kw == Keyword::rmStart)
+                            if (proc_rm)
                             {
-                                proc_rm = true;
+                                proc_rm = false;
+                                skipThisLine = true;
                             }
-                            else if (kw == Keyword::rmEnd)
+                            else
                             {
-                                if (proc_rm)
-                                {
-                                    proc_rm = false;
-                                    outBuff.clear();
-                                    skipThisLine = true;
-                                }
-                                else
-                                {
-                                    ++r.err;
-                                    printError(ewiFile, "###unexpected \"endrm\"", pPos.ln, kwCol);
-                                }
+                                ++r.err;
+                                printError(ewiFile, "###unexpected \"endrm\"", pPos.ln, kwCol);
                             }
-                            else if (kw == Keyword::rmn)
+                        }
+                        else if (kw == Keyword::rmn)
+                        {
+                            // skip space
+                            while ((p < pMax) && isSpace(p))
                             {
-                                // skip space
-                                while ((p < pMax) && isSpace(p))
-                                {
-                                    ++p;
-                                    ++pPos.col;
-                                }
+                                ++p;
+                                ++pPos.col;
+                            }
 
-                                const size_t argCol = pPos.col;
+                            const size_t argCol = pPos.col;
 
-                                // get arg
-                                string arg = "";
-                                while ((p < pMax) && !isWhiteSpace(p))
-                                {
-                                    arg += *p;
-                                    ++p;
-                                    ++pPos.col;
-                                }
+                            // get arg
+                            const string_view arg = nextToken(p, pMax, pPos);
 
 
-                                if (arg.length() == 0)
-                                {
-                                    ++r.err;
-                                    printError(ewiFile, "###missing argument of @rmn@", pPos.ln, pPos.col);
-                                }
-                                else if ((arg.length() == 1) && (arg[0] >= 0x30) && (arg[0] <= 0x39))
-                                {
-                                    proc_rmn = (arg[0] - 0x30) + 1;
-                                }
-                                else
-                                {
-                                    ++r.err;
-                                    printError(ewiFile, "###invalid argument of @rmn@: \"" + arg + "\"", pPos.ln, argCol);
-                                }
+                            if (arg.length() == 0)
+                            {
+                                ++r.err;
+                                printError(ewiFile, "###missing argument of @rmn@", pPos.ln, pPos.col);
                             }
-                            else if (kw == Keyword::ins)
+                            else if ((arg.length() == 1) && (arg[0] >= 0x30) && (arg[0] <= 0x39))
                             {
-                                if (p < pMax)
-                                {
-                                    ++p; // skip the space
-                                    ++pPos.col;
-                                }
+                                proc_rmn = (arg[0] - 0x30) + 1;
                             }
-                            else if (kw == Keyword::include)
+                            else
                             {
-                                skipThisLine = true;
+                                ++r.err;
+                                printError(ewiFile, "###invalid argument of @rmn@: \"" + string(arg) + "\"", pPos.ln, argCol);
+                            }
+                        }
+                        else if (kw == Keyword::ins)
+                        {
+                            if (p < pMax)
+                            {
+                                ++p; // skip the space
+                                ++pPos.col;
+                            }
+                        }
+                        else if (kw == Keyword::include)
+                        {
+                            skipThisLine = true;
 
-                                // skip space
-                                while ((p < pMax) && isSpace(p))
-                                {
-                                    ++p;
-                                    ++pPos.col;
-                                }
+                            // skip space
+                            while ((p < pMax) && isSpace(p))
+                            {
+                                ++p;
+                                ++pPos.col;
+                            }
 
-                                const size_t pathCol = pPos.col;
+                            const size_t pathCol = pPos.col;
 
-                                if (p >= pMax)
+                            if (p >= pMax)
+                            {
+                                ++r.err;
+                                printError(ewiFile, "###missing argument of @include@", pPos.ln, pPos.col);
+                            }
+                            else
+                            {
+                                // get path type
+                                char pathTypeChar = *p;
+                                char pathTypeCloseingChar = getCloseingIncPathChar(pathTypeChar);
+                                ++p;
+                                ++pPos.col;
+
+                                if (pathTypeCloseingChar == 0)
                                 {
                                     ++r.err;
-                                    printError(ewiFile, "###missing argument of @include@", pPos.ln, pPos.col);
+                                    printError(ewiFile, "invalid path type", pPos.ln, pathCol);
                                 }
                                 else
                                 {
-                                    // get path type
-                                    char pathTypeChar = *p;
-                                    char pathTypeCloseingChar = getCloseingIncPathChar(pathTypeChar);
-                                    ++p;
-                                    ++pPos.col;
+                                    // get path
+                                    const char* const pathBegin = p;
+                                    bool escaped = false;
 
-                                    if (pathTypeCloseingChar == 0)
+                                    while ((p < pMax) && ((*p != pathTypeCloseingChar) || (*(p - 1) == '\\')) && !isNewLine(p)) // p-1 is a valid pointer at this position, because there is allway a tag before p.
                                     {
-                                        ++r.err;
-                                        printError(ewiFile, "invalid path type", pPos.ln, pathCol);
+                                        if (*p == '\\') escaped = true;
+                                        ++p;
                                     }
-                                    else
+
+                                    pPos.col += static_cast<size_t>(p - pathBegin);
+
+                                    // the path is a view into the data, it's only copied if it has to be unescaped
+                                    string_view pathStr(pathBegin, static_cast<size_t>(p - pathBegin));
+                                    string unescaped;
+
+                                    if (escaped)
                                     {
-                                        // get path
-                                        string pathStr = "";
-                                        while ((p < pMax) && ((*p != pathTypeCloseingChar) || (*(p - 1) == '\\')) && !isNewLine(p)) // p-1 is a valid pointer at this position, because there is allway a tag before p.
-                                        {
-                                            pathStr += *p;
-                                            ++p;
-                                            ++pPos.col;
-                                        }
+                                        unescaped.assign(pathStr);
+
                                         char replace[] = { '\\', pathTypeChar, 0 };
                                         char replaceWith[] = { pathTypeChar, 0 };
-                                        strReplaceAll(pathStr, replace, replaceWith);
+                                        strReplaceAll(unescaped, replace, replaceWith);
                                         replace[1] = pathTypeCloseingChar;
                                         replaceWith[0] = pathTypeCloseingChar;
-                                        strReplaceAll(pathStr, replace, replaceWith);
+                                        strReplaceAll(unescaped, replace, replaceWith);
 
-                                        if ((*p == pathTypeCloseingChar) && (pathStr.length() > 0))
-                                        {
-                                            ++p;
-                                            ++pPos.col;
+                                        pathStr = unescaped;
+                                    }
 
-                                            fs::path incPath(pathStr);
+                                    if ((p < pMax) && (*p == pathTypeCloseingChar) && (pathStr.length() > 0))
+                                    {
+                                        ++p;
+                                        ++pPos.col;
 
-                                            if (incPath.is_relative())
-                                            {
-                                                incPath = fs::absolute(job.getInputFile()).parent_path() / pathStr;
-                                            }
+                                        fs::path incPath(pathStr);
+
+                                        if (incPath.is_relative())
+                                        {
+                                            incPath = srcFile.parent_path() / pathStr;
+                                        }
 #if PRJ_DEBUG && 0
-                                            string incTypeDispStr = "?";
-                                            if (pathTypeChar == incPathType_rel_Char) incTypeDispStr = "relative to file";
-                                            else if (pathTypeChar == incPathType_path_Char) incTypeDispStr = "relative to path in potoroo config";
-                                            else if (pathTypeChar == incPathType_dirty_Char) incTypeDispStr = "relative to file (no preProc, dirty include)";
-                                            printDbg(ewiFile, "###include path: \"" + pathStr + "\" => \"" + incPath.string() + "\" - " + incTypeDispStr, pPos);
+                                        string incTypeDispStr = "?";
+                                        if (pathTypeChar == incPathType_rel_Char) incTypeDispStr = "relative to file";
+                                        else if (pathTypeChar == incPathType_path_Char) incTypeDispStr = "relative to path in potoroo config";
+                                        else if (pathTypeChar == incPathType_dirty_Char) incTypeDispStr = "relative to file (no preProc, dirty include)";
+                                        printDbg(ewiFile, "###include path: \"" + string(pathStr) + "\" => \"" + incPath.string() + "\" - " + incTypeDispStr, pPos);
 #endif
-                                            if (fs::exists(incPath))
+                                        if (ctx.exists(incPath))
+                                        {
+                                            IncludeId incId;
+                                            ctx.incPathStack.id(incPath, incId);
+
+                                            if (!ctx.incPathStack.contains(incId))
                                             {
-                                                if (!incPathStack.contains(incPath))
+                                                ctx.incPathStack.push(incPath, incId);
+
+                                                if (ctx.incPathHistory.contains(incId))
                                                 {
-                                                    incPathStack.push(incPath);
+                                                    ++ctx.nCtxDependent;
+                                                    r += warn(ewiFile, wID_include_multiInc, job, "included same file multiple times", ProcPos(pPos.ln, pathCol));
+                                                }
 
-                                                    if (incPathHistory.contains(incPath))
-                                                    {
-                                                        r += warn(ewiFile, wID_include_multiInc, job, "included same file multiple times", ProcPos(pPos.ln, pathCol));
-                                                    }
+                                                ctx.incPathHistory.push(incPath, incId);
 
-                                                    incPathHistory.push(incPath);
+                                                uint64_t incNs = 0;
+                                                StatsTimer incTimer(ctx.stats ? &incNs : nullptr);
 
-                                                    if (pathTypeChar == incPathType_rel_Char) r += includeRel(ofs, incPath, outf, job, ewiFile, pPos, pathCol);
-                                                    else if (pathTypeChar == incPathType_dirty_Char) r += includeDirty(ofs, incPath, outf, job, ewiFile, pPos, pathCol);
-                                                    else
-                                                    {
-                                                        ++r.err;
-                                                        printError(ewiFile, "ERROR - unimplemented include path type - " + string(__FILENAME__) + ":" + to_string(__LINE__), pPos);
-                                                    }
+                                                if (ctx.stats && (ctx.incPathStack.size() > ctx.stats->includeDepth)) ctx.stats->includeDepth = ctx.incPathStack.size();
 
-                                                    incPathStack.pop();
-                                                }
+                                                if (pathTypeChar == incPathType_rel_Char) r += includeRel(ctx, out, incPath, job, ewiFile, pPos, pathCol);
+                                                else if (pathTypeChar == incPathType_dirty_Char) r += includeDirty(ctx, out, incPath, job, ewiFile, pPos, pathCol);
                                                 else
                                                 {
                                                     ++r.err;
-                                                    printError(ewiFile, "include loop detected - include stack:\n" + incPathStack.toString(), pPos.ln, pathCol);
+                                                    printError(ewiFile, "ERROR - unimplemented include path type - " + string(__FILENAME__) + ":" + to_string(__LINE__), pPos);
                                                 }
+
+                                                if (ctx.stats)
+                                                {
+                                                    incTimer.stop();
+
+                                                    IncludeStats& incStats = ctx.includeStats(incPath);
+                                                    ++incStats.count;
+                                                    incStats.ns += incNs;
+
+                                                    // nested includes are part of the time of their outermost include
+                                                    if (ctx.incPathStack.size() == 1) ctx.stats->nsInclude += incNs;
+                                                }
+
+                                                ctx.incPathStack.pop();
                                             }
                                             else
                                             {
+                                                ++ctx.nCtxDependent;
                                                 ++r.err;
-                                                printError(ewiFile, "include file does not exist", pPos.ln, pathCol);
+                                                printError(ewiFile, "include loop detected - include stack:\n" + ctx.incPathStack.toString(), pPos.ln, pathCol);
                                             }
                                         }
                                         else
                                         {
                                             ++r.err;
-                                            printError(ewiFile, "invalid include path", pPos.ln, pathCol);
+                                            printError(ewiFile, "include file does not exist", pPos.ln, pathCol);
                                         }
                                     }
+                                    else
+                                    {
+                                        ++r.err;
+                                        printError(ewiFile, "invalid include path", pPos.ln, pathCol);
+                                    }
                                 }
                             }
-                            else
-                            {
-                                ++r.err;
-                                printError(ewiFile, "###unknown keyword \"" + kwStr + "\"", pPos.ln, kwCol);
-                            }
+                        }
+                        else
+                        {
+                            ++r.err;
+                            printError(ewiFile, "###unknown keyword \"" + string(kwStr) + "\"", pPos.ln, kwCol);
+                        }
 
 
-                            // check if line is empty after keyword
-                            if (p < pMax)
+                        // check if line is empty after keyword
+                        if (p < pMax)
+                        {
+                            if ((kw != Keyword::ins) && !isNewLine(p))
                             {
-                                if ((kw != Keyword::ins) && !isNewLine(p))
-                                {
-                                    r += warn(ewiFile, wID_instrLineEnd, job, "no new line after expression", pPos);
-                                }
+                                r += warn(ewiFile, wID_instrLineEnd, job, "no new line after expression", pPos);
                             }
                         }
                     }
+
+                    restBegin = p;
+                }
+            }
+
+
+
+            // copy until line end, including the new line
+            const char* lineEnd = static_cast<const char*>(memchr(p, 0x0A, pMax - p));
+            if (lineEnd) ++lineEnd;
+            else lineEnd = pMax;
+
+            p = lineEnd;
+
+            ++pPos.ln;
+            pPos.col = 1;
+
+            if ((proc_rmn > 0) || proc_rm || skipThisLine) skipThisLine = false;
+            else
+            {
+                // write to outf
+                if (restBegin == wsEnd) out.write(lineBegin, lineEnd - lineBegin);
+                else
+                {
+                    if (wsEnd > lineBegin) out.write(lineBegin, wsEnd - lineBegin);
+                    if (lineEnd > restBegin) out.write(restBegin, lineEnd - restBegin);
+                }
+            }
+
+            if (proc_rmn > 0) --proc_rmn;
+        }
+
+        if (proc_rm)
+        {
+            ++r.err;
+            printError(ewiFile, "###missing @endrm@", pPos.ln, pPos.col);
+        }
+
+        if (proc_rmn)
+        {
+            r += warn(ewiFile, wID_rmnEOF, job, "###@rmn@ overlapped EOF", pPos);
+        }
+
+        return r;
+    }
+
+    //! @brief Converts the input to LF, on which the processor works
+    //! @param [in,out] data Points to dataLF if the input has been converted
+    //! @param [in,out] size
+    //! @param [out] dataLF
+    //! @param ile Detected line ending of the input
+    //! @param leInfo
+    //! @param job
+    //! @param ewiFile
+    Result inputToLF(const char*& data, size_t& size, vector<char>& dataLF, lineEnding ile, const LineEndingInfo& leInfo, const Job& job, const string& ewiFile)
+    {
+        Result r;
+
+        if (leInfo.mixed())
+        {
+            const string cntStr = to_string(leInfo.nLF) + " LF, " + to_string(leInfo.nCR) + " CR, " + to_string(leInfo.nCRLF) + " CRLF";
+            r += warn(ewiFile, wID_endlMixed, job, "mixed line endings (" + cntStr + "), writing " + lineEndingName(ile));
+        }
+
+        if ((ile == lineEnding::CR) || (ile == lineEnding::CRLF))
+        {
+            if (convertLineEnding(data, size, ile, dataLF, lineEnding::LF) != 0)
+            {
+                ++r.err;
+                printError(ewiFile, "convert line ending of input file failed");
+                return r;
+            }
+
+            data = dataLF.data();
+            size = dataLF.size();
+        }
+
+        return r;
+    }
+
+    // should not throw explicitly because then the out file does not get deleted.
+    // CR and CRLF files are converted to LF in memory and back to their line ending on output
+    Result caterpillarProc(ProcContext& ctx, const fs::path& inf, lineEnding& ile, const fs::path& outf, const FileMeta& outMeta, const Job& job, const string& ewiFile)
+    {
+        Result r;
+        InputFile ifile;
+        JobStats* const stats = ctx.stats;
+
+        StatsTimer readTimer(stats ? &stats->nsRead : nullptr);
+        TraceSpan readSpan("read", "phase");
+
+        string ifErrMsg;
+        if (ifile.open(inf, ifErrMsg) != 0)
+        {
+            printError(ewiFile, "could not read input file - " + ifErrMsg);
+            return 1;
+        }
+
+        readTimer.stop();
+        readSpan.end();
+
+        const char* data = ifile.data();
+        size_t size = ifile.size();
+        vector<char> dataLF;
+
+        if (stats) stats->bytesIn += size;
+        ctx.bufferAcquire(size);
+
+        StatsTimer leTimer(stats ? &stats->nsLineEndings : nullptr);
+        TraceSpan leSpan("detect line ending", "phase");
+
+        LineEndingInfo leInfo;
+        ile = detectLineEnding(data, size, leInfo);
+
+        leTimer.stop();
+        leSpan.end();
+
+        // Without a tag the processor would write the input unchanged, it's copied by the kernel.
+        // Mixed line endings are normalized by the processor, so they have to go the long way.
+        const string tag = job.getTag() + " ";
+
+        if (!leInfo.mixed() && !unsupportedEncoding(data, size) && (scanFindString(data, data + size, tag.c_str(), tag.length()) == (data + size)))
+        {
+            StatsTimer writeTimer(stats ? &stats->nsWrite : nullptr);
+            TraceSpan writeSpan("copy", "phase");
+            string errMsg;
+
+            if (stats) stats->bytesOut = size;
+
+            if (job.writeIfChanged() && equalContent(outf, outMeta, data, size)) ctx.outcome.unchanged = true;
+            else if (copyFile(inf, outf, &ifile, job.writeIfChanged(), errMsg) != 0)
+            {
+                ++r.err;
+                printError(ewiFile, "could not write output file - " + errMsg);
+            }
+            else ctx.outcome.copied = true;
+
+            return r;
+        }
+
+        {
+            StatsTimer convTimer(stats ? &stats->nsLineEndings : nullptr);
+            TraceSpan convSpan("convert line ending", "phase");
+            r += inputToLF(data, size, dataLF, ile, leInfo, job, ewiFile);
+        }
+
+        if (r.err) return r;
+
+        ctx.bufferAcquire(dataLF.size());
+
+        ProcOutput out;
+        uint64_t nsProc = 0;
+        StatsTimer procTimer(stats ? &nsProc : nullptr);
+        TraceSpan procSpan("scan", "phase");
+
+        r += caterpillarProc(ctx, out, data, size, job.getInputPath(), job, ewiFile);
+
+        // the time of the includes is accounted separately
+        if (stats) stats->nsScan += procTimer.stop() - stats->nsInclude;
+        procSpan.end();
+
+        StatsTimer writeTimer(stats ? &stats->nsWrite : nullptr);
+        TraceSpan writeSpan("write", "phase");
+
+        // the output file is removed anyway if there are errors
+        if ((r.err == 0) && job.writeIfChanged() && outMeta.regular)
+        {
+            InputFile prevOut;
+
+            if ((prevOut.open(outf) == 0) && out.equals(prevOut.data(), prevOut.size(), ile)) ctx.outcome.unchanged = true;
+        }
+
+        if ((r.err == 0) && !ctx.outcome.unchanged)
+        {
+            OutputFile ofile;
+            string errMsg;
+            int res = (job.writeIfChanged() ? ofile.openReplace(outf, errMsg) : ofile.open(outf, errMsg));
+
+            if (res == 0) res = out.writeTo(ofile, ile, errMsg, (stats ? &stats->bytesOut : nullptr));
+
+            if (res == 0) res = ofile.close(errMsg);
+            else ofile.discard();
+
+            if (res != 0)
+            {
+                ++r.err;
+                printError(ewiFile, "could not write output file - " + errMsg);
+            }
+        }
+
+        return r;
+    }
+
+    //! @brief Processes a job
+    //! @param job
+    //! @param incCache
+    //! @param metaCache
+    //! @param [out] deps Files included by the job, may be nullptr
+    //! @param [out] outcome How the output file has been written, may be nullptr
+    //! @param [out] stats Statistics of the job are added, may be nullptr
+    Result processJob(const Job& job, IncludeCache& incCache, FileMetaCache& metaCache, vector<fs::path>* deps, JobOutcome* outcome, JobStats* stats = nullptr) noexcept
+    {
+        Result r;
+        fs::path inf_data;
+        fs::path outf_data;
+        const fs::path& inf = inf_data;
+        const fs::path& outf = outf_data;
+        string ewiFile;
+        bool createdOutDir = false;
+        ProcContext ctx(incCache, metaCache);
+        ctx.stats = stats;
+
+        try
+        {
+            inf_data = job.getInputPath();
+            outf_data = job.getOutputPath();
+        }
+        catch (exception& ex)
+        {
+            ++r.err;
+            printError("", ex.what());
+        }
+        catch (...)
+        {
+            ++r.err;
+            printError("", "invalid in or out filename");
+        }
+
+        lineEnding ile = lineEnding::error; // detected by the processor
+        bool sameFile = false;
+
+        if (r.err == 0)
+        {
+            try { ewiFile = inf.filename().string(); }
+            catch (...) { ewiFile = job.getInputFile(); }
+
+            try
+            {
+                // one stat per file answers all the questions below
+                FileMeta inMeta, outMeta;
+
+                if (metaCache.get(inf, inMeta) != 0) throw runtime_error("could not read the file metadata");
+                if (!inMeta.exists) throw runtime_error("file does not exist");
+                if (metaCache.get(outf, outMeta) != 0) throw runtime_error("could not read the metadata of the output file");
+                sameFile = FileMeta::equivalent(inf, inMeta, outf, outMeta);
+                if (sameFile) throw runtime_error("in and out files are the same");
+
+                if (!outMeta.exists) createdOutDir = metaCache.createDirectories(outf.parent_path());
+
+
+
+                if (job.getMode() == JobMode::proc) r += caterpillarProc(ctx, inf, ile, outf, outMeta, job, ewiFile);
+                else if ((job.getMode() == JobMode::copy) || (job.getMode() == JobMode::copyow) || (job.getMode() == JobMode::copycmp))
+                {
+                    bool upToDate = false;
+
+                    if (outMeta.exists && (job.getMode() == JobMode::copy)) upToDate = (inMeta.mtime <= outMeta.mtime);
+
+                    if (!upToDate && outMeta.exists && ((job.getMode() == JobMode::copycmp) || job.writeIfChanged()))
+                    {
+                        upToDate = equalContent(inf, inMeta, outf, outMeta);
+                        ctx.outcome.unchanged = upToDate;
+                    }
+
+                    if (!upToDate)
+                    {
+                        StatsTimer writeTimer(stats ? &stats->nsWrite : nullptr);
+                        TraceSpan copySpan("copy", "phase");
+                        string errMsg;
+
+                        if (stats)
+                        {
+                            stats->bytesIn += inMeta.size;
+                            stats->bytesOut = inMeta.size;
+                        }
+
+                        if (!inMeta.regular)
+                        {
+                            ++r.err;
+                            printError(ewiFile, "file not copied - not a regular file");
+                        }
+                        else if (copyFile(inf, outf, nullptr, job.writeIfChanged(), errMsg) != 0)
+                        {
+                            ++r.err;
+                            printError(ewiFile, "file not copied - " + errMsg);
+                        }
+                        else
+                        {
+                            error_code ec;
+                            fs::permissions(outf, inMeta.perms, ec);
+                        }
+                    }
+    #if PRJ_DEBUG && 0
+                    else printDbg(ewiFile, "file not copied, it's up to date");
+    #endif
                 }
-
-
-
-                // copy until line end
-                while ((p < pMax) && !isNewLine(p))
+                else
                 {
-                    outBuff.push_back(*p);
-                    ++p;
-                    ++pPos.col;
+                    ++r.err;
+                    printError("processor", "invalid job mode");
                 }
+            }
+            catch (exception& ex)
+            {
+                ++r.err;
+                printError(ewiFile, ex.what());
+            }
+            catch (...)
+            {
+                ++r.err;
+                printError(ewiFile, "unknown");
+            }
+        }
 
+        if (job.warningAsError() && (r.warn > 0))
+        {
+            ++r.err;
+            printError(ewiFile, "###[@Werror@] " + to_string(r.warn) + " warnings");
+        }
 
+        if (r.err > 0)
+        {
+            if (job.writeErrorLine())
+            {
+                const string exMsg = "###[@" + argStr_wrErrLn + "@] could not write file";
 
-                // new line
-                if (p < pMax)
+                try
                 {
-                    outBuff.push_back(*p);
-                    ++p;
-                }
+                    ofstream ofs;
+                    ofs.exceptions(ios::failbit | ios::badbit | ios::eofbit);
+                    ofs.open(outf, ios::out | ios::binary);
+
+                    string str = job.writeErrorLineStr();
 
-                ++pPos.ln;
-                pPos.col = 1;
+                    if (ile == lineEnding::error) ile = detectLineEnding(inf);
 
-                if ((proc_rmn > 0) || proc_rm || skipThisLine)
+                    if ((ile == lineEnding::CR) || (ile == lineEnding::CRLF)) str += '\r';
+                    if ((ile == lineEnding::CRLF) || (ile == lineEnding::LF) || (ile == lineEnding::error)) str += '\n';
+
+                    ofs.write(str.c_str(), str.length());
+                }
+                catch (...)
                 {
-                    skipThisLine = false;
-                    outBuff.clear();
+                    ++r.err;
+                    printError(ewiFile, exMsg);
                 }
+            }
+            else if (!sameFile)
+            {
+                r += rmOut(outf, ewiFile, job, createdOutDir);
+                if (createdOutDir) metaCache.invalidate(outf.parent_path());
+            }
+        }
 
-                if (proc_rmn > 0) --proc_rmn;
+        // the output file has been written or removed
+        if (!outf.empty()) metaCache.invalidate(outf);
 
+        if (deps)
+        {
+            deps->clear();
+            for (size_t i = 0; i < ctx.incPathHistory.size(); ++i) deps->push_back(ctx.incPathHistory.at(i));
+        }
 
+        if (outcome) *outcome = ((r.err == 0) ? ctx.outcome : JobOutcome());
 
-                // write to outf
-                if (outBuff.size() > 0) ofs.write(outBuff.data(), outBuff.size());
-            }
+        return r;
+    }
 
-#if PRJ_DEBUG && 0
-            for (int i = 0; i < 2; ++i) ofs << (char)0xE2 << (char)0x96 << (char)0x88; // full block
-#endif
+    //! @brief Prints the progress line of a job in the format of printEWI()
+    void printJobStatus(const char* status, const Job& job)
+    {
+        const EwiFormat format = ewiFormat();
+
+        if (format == EwiFormat::text) ewiStream() << status << " " << job << '\n';
+        else if (format == EwiFormat::jsonLines)
+        {
+            ewiStream() << "{\"type\":\"job\",\"status\":\"" << status << "\",\"input\":\"" << jsonEscape(job.getInputFile()) << "\",\"output\":\"" << jsonEscape(job.getOutputFile()) << "\"}\n";
         }
+    }
 
-        if (proc_rm)
+    //! @brief Processes a job of processJobs(), or skips it if it is up to date
+    //! @param [out] deps Files included by the job, may be nullptr
+    //! @param [out] stats May be nullptr
+    //!
+    //! Skipped jobs report the warnings of their recorded run again.
+    //!
+    Result runJob(const Job& job, IncludeCache& incCache, FileMetaCache& metaCache, StampDb* stampDb, JobOutcome& outcome, vector<fs::path>* deps, JobStats* stats) noexcept
+    {
+        Result r;
+
+        outcome = JobOutcome();
+        if (deps) deps->clear();
+        if (stats) *stats = JobStats();
+
+        TraceSpan span("job", "job");
+
+        if (span.active())
         {
-            ++r.err;
-            printError(ewiFile, "###missing @endrm@", pPos.ln, pPos.col);
+            span.rename(job.getInputFile());
+            span.arg("output", job.getOutputFile());
         }
 
-        if (proc_rmn)
+        if (stampDb)
         {
-            r += warn(ewiFile, wID_rmnEOF, job, "###@rmn@ overlapped EOF", pPos);
+            vector<EWIMessage> diag;
+
+            if (stampDb->isUpToDate(job, r, diag, &metaCache))
+            {
+                span.arg("skipped", 1);
+                printJobStatus("up to date", job);
+                for (size_t i = 0; i < diag.size(); ++i) printEWI(diag[i]);
+                return r;
+            }
         }
 
-        ifs.close();
-        ofs.close();
+        printJobStatus("process", job);
+
+        if (stats) stats->processed = true;
+
+        if (stampDb)
+        {
+            vector<EWIMessage> diag;
+            vector<fs::path> jobDeps;
+
+            setEwiCapture(&diag);
+            r = processJob(job, incCache, metaCache, &jobDeps, &outcome, stats);
+            setEwiCapture(nullptr);
+
+            for (size_t i = 0; i < diag.size(); ++i) printEWI(diag[i]);
+
+            stampDb->update(job, jobDeps, r, diag, &metaCache);
+
+            if (deps) *deps = jobDeps;
+        }
+        else r = processJob(job, incCache, metaCache, deps, &outcome, stats);
 
         return r;
     }
 }
 
-Result potoroo::processJob(const Job& job, bool forceOutfLineEndLF) noexcept
+struct potoroo::ProcSession::Impl
 {
-    Result r;
-    fs::path inf_data;
-    fs::path outf_data;
-    const fs::path& inf = inf_data;
-    const fs::path& outf = outf_data;
-    string ewiFile;
-    bool createdOutDir = false;
+    shared_ptr<IncludeCache> incCache;
+};
 
-    try
+potoroo::IncludeStats::IncludeStats()
+    : count(0), nCached(0), ns(0), bytesRead(0)
+{
+}
+
+potoroo::JobStats::JobStats()
+    : processed(false),
+    nsRead(0), nsLineEndings(0), nsScan(0), nsInclude(0), nsWrite(0),
+    bytesIn(0), bytesOut(0),
+    nRm(0), nEndrm(0), nRmn(0), nIns(0), nInclude(0),
+    includeDepth(0), peakBufferSize(0)
+{
+}
+
+//! @brief Sums up the statistics, except of the includes
+JobStats& potoroo::JobStats::operator+=(const JobStats& other)
+{
+    processed = processed || other.processed;
+    nsRead += other.nsRead;
+    nsLineEndings += other.nsLineEndings;
+    nsScan += other.nsScan;
+    nsInclude += other.nsInclude;
+    nsWrite += other.nsWrite;
+    bytesIn += other.bytesIn;
+    bytesOut += other.bytesOut;
+    nRm += other.nRm;
+    nEndrm += other.nEndrm;
+    nRmn += other.nRmn;
+    nIns += other.nIns;
+    nInclude += other.nInclude;
+    if (other.includeDepth > includeDepth) includeDepth = other.includeDepth;
+    if (other.peakBufferSize > peakBufferSize) peakBufferSize = other.peakBufferSize;
+
+    return *this;
+}
+
+potoroo::ProcStats::ProcStats()
+    : nCopied(0), nUnchanged(0), nSyscallsSaved(0), collectJobStats(false), nsWall(0)
+{
+}
+
+potoroo::ProcSession::ProcSession()
+    : impl(make_unique<Impl>())
+{
+    impl->incCache = make_shared<IncludeCache>();
+}
+
+//! @brief Creates a session which shares the caches of other
+//!
+//! The dependencies recorded by processJobs() are not shared, so sessions sharing their caches
+//! can be used by different threads at the same time.
+//!
+potoroo::ProcSession::ProcSession(ProcSession& other)
+    : impl(make_unique<Impl>())
+{
+    impl->incCache = other.impl->incCache;
+}
+
+potoroo::ProcSession::~ProcSession()
+{
+}
+
+//! @brief Drops the cached results of the file and of all included files which included it
+void potoroo::ProcSession::invalidate(const std::filesystem::path& file)
+{
+    impl->incCache->invalidate(file);
+}
+
+//! @brief Drops the cached results of all files which changed since they were processed
+//!
+//! Needed if the files are not watched, costs one stat per cached file.
+//!
+void potoroo::ProcSession::validate()
+{
+    impl->incCache->validate();
+}
+
+//! @brief Processes a single job
+//! @param job
+//! @param session Provides the include cache, may be nullptr
+Result potoroo::processJob(const Job& job, ProcSession* session) noexcept
+{
+    IncludeCache localIncCache;
+    IncludeCache& incCache = (session ? *session->impl->incCache : localIncCache);
+    FileMetaCache metaCache;
+
+    return processJob(job, incCache, metaCache, nullptr, nullptr);
+}
+
+//! @brief Processes the jobs
+//! @param jobs
+//! @param [out] success
+//! @param nThreads Number of jobs processed in parallel, 0 to use the number of hardware threads
+//! @param stampDb Jobs which are up to date are skipped and the database is updated, may be nullptr
+//! @param [out] stats May be nullptr
+//! @param session Keeps the include results for the next call and records the dependencies of the jobs, may be nullptr
+//!
+//! The diagnostics of the jobs are buffered and printed in the order of the jobs. Jobs which
+//! share files run one after the other in jobfile order, see jobGroups().
+//!
+Result potoroo::processJobs(const std::vector<Job>& jobs, std::vector<bool>& success, size_t nThreads, StampDb* stampDb, ProcStats* stats, ProcSession* session) noexcept
+{
+#if PRJ_DEBUG && 0
+    cout << "===============\n" << "jobs:" << endl;
+    for (size_t i = 0; i < jobs.size(); ++i)
     {
-        inf_data = fs::absolute(job.getInputFile());
-        outf_data = fs::absolute(job.getOutputFile());
-    }
-    catch (exception& ex)
+        cout << setw(3) << i << " ";
+
+        if (jobs[i].isValid())
+        {
+            cout << "\"" << jobs[i].getInputFile() << "\" " << "\"" << jobs[i].getOutputFile() << "\" " << "\"" << jobs[i].getTag() << "\"" << (jobs[i].warningAsError() ? " Werror" : "");
+        }
+        else cout << "invalid: " << jobs[i].getErrorMsg();
+
+        cout << endl;
+}
+    cout << "===============" << endl;
+#endif
+
+#if PRJ_DEBUG && 0
+    printInfo("processor", "current dir: " + pathToStr(fs::current_path()) + "\n");
+#endif
+
+
+    Result pr;
+
+    if (jobs.size() != success.size())
     {
-        ++r.err;
-        printError("", ex.what());
+        printEWI("internal", "fatal! " + string(__FILENAME__) + ":" + to_string(__LINE__) + ": jobs.size() != success.size()", 0, 0, 0, 0);
+        ++pr.err;
     }
-    catch (...)
+
+    IncludeCache localIncCache;
+    IncludeCache& incCache = (session ? *session->impl->incCache : localIncCache);
+    FileMetaCache metaCache;
+    ProcStats st;
+
+    if (session)
     {
-        ++r.err;
-        printError("", "invalid in or out filename");
+        session->deps.clear();
+        session->deps.resize(jobs.size());
     }
 
-    const lineEnding ile = detectLineEnding(inf);
+    // each job writes its own element, so the workers don't need to synchronize
+    const bool collectJobStats = (stats && stats->collectJobStats);
+    vector<JobStats> jobStats(collectJobStats ? jobs.size() : 0);
+    StatsTimer wallTimer(collectJobStats ? &st.nsWall : nullptr);
+    TraceSpan span("processJobs", "run");
 
-    if (r.err == 0)
-    {
-        try { ewiFile = inf.filename().string(); }
-        catch (...) { ewiFile = job.getInputFile(); }
+    size_t nWorkers = nThreads;
+    if (nWorkers == 0) nWorkers = thread::hardware_concurrency();
+    if (nWorkers > jobs.size()) nWorkers = jobs.size();
 
-        try
+    if (nWorkers <= 1)
+    {
+        for (size_t i = 0; i < jobs.size(); ++i)
         {
-            if (!fs::exists(inf)) throw runtime_error("file does not exist");
+            JobOutcome outcome;
+            Result r = runJob(jobs[i], incCache, metaCache, stampDb, outcome, (session ? &session->deps[i] : nullptr), (collectJobStats ? &jobStats[i] : nullptr));
+            pr += r;
 
-            if (fs::exists(outf))
+            if (outcome.copied) ++st.nCopied;
+            if (outcome.unchanged) ++st.nUnchanged;
+
+            if (i < success.size())
             {
-                if (fs::equivalent(inf, outf)) throw runtime_error("in and out files are the same");
+                success[i] = (r.err == 0);
             }
+        }
+    }
+    else
+    {
+        // jobs sharing files run on the same worker in jobfile order
+        const vector<vector<size_t>> groups = jobGroups(jobs);
 
-            createdOutDir = fs::create_directories(outf.parent_path());
+        vector<JobSlot> slots(jobs.size());
+        atomic<size_t> next(0);
+        mutex mtx;
+        condition_variable cv;
 
+        const EwiFormat format = ewiFormat();
 
+        const auto worker = [&]()
+        {
+            size_t g;
 
-            if (job.getMode() == JobMode::proc)
-            {
-                if (ile == lineEnding::error)
-                {
-                    r += warn(ewiFile, wID_endlAssumeLF, job, "Unable to determine line ending, assuming LF");
-                }
+            setEwiFormat(format);
 
-                if ((ile == lineEnding::LF) || (ile == lineEnding::error)) r += caterpillarProc(inf, outf, job, ewiFile);
-                else
+            while ((g = next.fetch_add(1)) < groups.size())
+            {
+                for (const size_t i : groups[g])
                 {
-                    const fs::path tmpProcDir(outf.parent_path() / processorTmpDirLineEnding);
-                    const fs::path infLF(tmpProcDir / (inf.filename().string() + ".infLF"));
-                    fs::path outfLF;
-
-                    if (forceOutfLineEndLF) outfLF = fs::path(outf);
-                    else outfLF = fs::path(tmpProcDir / (outf.filename().string() + ".outfLF"));
-
-                    fs::create_directories(tmpProcDir);
+                    JobSlot& slot = slots[i];
 
-                    string errMsg;
-                    bool deleteTmpProcDir = true;
+                    JobOutcome outcome;
 
-                    if (convertLineEnding(inf, ile, infLF, lineEnding::LF, errMsg) == 0)
-                    {
-                        r += caterpillarProc(infLF, outfLF, job, ewiFile);
+                    setEwiStream(&slot.diag);
+                    const Result r = runJob(jobs[i], incCache, metaCache, stampDb, outcome, (session ? &session->deps[i] : nullptr), (collectJobStats ? &jobStats[i] : nullptr));
+                    setEwiStream(nullptr);
 
-                        if ((r.err == 0) && !forceOutfLineEndLF)
-                        {
-                            if (convertLineEnding(outfLF, lineEnding::LF, outf, ile, errMsg) != 0)
-                            {
-                                deleteTmpProcDir = false;
-                                r += warn(ewiFile, wID_convEndlFail, job, "convert line ending failed" + (errMsg.length() > 0 ? (" - " + errMsg) : ""));
-                            }
-                        }
-                    }
-                    else
                     {
-                        ++r.err;
-                        printError(ewiFile, "convert line ending of include file failed" + (errMsg.length() > 0 ? (" - " + errMsg) : ""));
+                        lock_guard<mutex> lock(mtx);
+                        slot.r = r;
+                        slot.outcome = outcome;
+                        slot.done = true;
                     }
 
-                    if (deleteTmpProcDir) fs::remove_all(tmpProcDir);
+                    cv.notify_all();
                 }
             }
-            else if (job.getMode() == JobMode::copy)
-            {
-                bool fileCopied = fs::copy_file(inf, outf, fs::copy_options::update_existing);
+        };
 
-#if PRJ_DEBUG && 0
-                if (!fileCopied) printDbg(ewiFile, "file not copied, it's up to date");
-#endif
-            }
-            else if (job.getMode() == JobMode::copyow)
-            {
-                bool fileCopied = fs::copy_file(inf, outf, fs::copy_options::overwrite_existing);
+        vector<thread> workers;
 
-                if (!fileCopied)
-                {
-                    ++r.err;
-                    printError(ewiFile, "file not copied");
-                }
-            }
-            else
+        try
+        {
+            for (size_t i = 0; i < nWorkers; ++i)
             {
-                ++r.err;
-                printError("processor", "invalid job mode");
-            }
+                workers.push_back(thread([&worker]()
+                    {
+                        traceThreadName("worker");
+                        worker();
+                    }));
             }
-        catch (exception& ex)
-        {
-            ++r.err;
-            printError(ewiFile, ex.what());
-        }
-        catch (...)
-        {
-            ++r.err;
-            printError(ewiFile, "unknown");
-        }
         }
+        catch (...) {}
 
-    if (job.warningAsError() && (r.warn > 0))
-    {
-        ++r.err;
-        printError(ewiFile, "###[@Werror@] " + to_string(r.warn) + " warnings");
-    }
+        if (workers.size() == 0) worker();
 
-    if (r.err > 0)
-    {
-        if (job.writeErrorLine())
+        // the diagnostics are printed in jobfile order as soon as a job and all its predecessors are done
+        for (size_t i = 0; i < jobs.size(); ++i)
         {
-            const string exMsg = "###[@" + argStr_wrErrLn + "@] could not write file";
+            JobSlot& slot = slots[i];
 
-            try
             {
-                ofstream ofs;
-                ofs.exceptions(ios::failbit | ios::badbit | ios::eofbit);
-                ofs.open(outf, ios::out | ios::binary);
+                unique_lock<mutex> lock(mtx);
+                cv.wait(lock, [&slot]() { return slot.done; });
+            }
 
-                string str = job.writeErrorLineStr();
+            ewiStream() << slot.diag.str();
+            slot.diag.str(string());
 
-                if ((ile == lineEnding::CR) || (ile == lineEnding::CRLF)) str += '\r';
-                if ((ile == lineEnding::CRLF) || (ile == lineEnding::LF) || (ile == lineEnding::error)) str += '\n';
+            pr += slot.r;
+            if (slot.outcome.copied) ++st.nCopied;
+            if (slot.outcome.unchanged) ++st.nUnchanged;
 
-                ofs.write(str.c_str(), str.length());
-            }
-            catch (...)
+            if (i < success.size())
             {
-                ++r.err;
-                printError(ewiFile, exMsg);
+                success[i] = (slot.r.err == 0);
             }
         }
-        else if (!fs::equivalent(inf, outf)) r += rmOut(outf, ewiFile, job, createdOutDir);
+
+        for (size_t i = 0; i < workers.size(); ++i) workers[i].join();
     }
 
-    return r;
+    // once per run instead of per message
+    ewiStream().flush();
+
+    st.nSyscallsSaved = metaCache.nSaved();
+
+    if (collectJobStats)
+    {
+        wallTimer.stop();
+        st.collectJobStats = true;
+        for (size_t i = 0; i < jobStats.size(); ++i) st.total += jobStats[i];
+        st.jobs = move(jobStats);
     }
 
-Result potoroo::processJobs(const std::vector<Job>& jobs, std::vector<bool>& success) noexcept
+    if (stats) *stats = st;
+
+    return pr;
+}
+
+
+
+potoroo::BufferOptions::BufferOptions()
+    : warningAsError(false)
 {
-#if PRJ_DEBUG && 0
-    cout << "===============\n" << "jobs:" << endl;
-    for (size_t i = 0; i < jobs.size(); ++i)
+}
+
+potoroo::Diagnostic::Diagnostic()
+    : severity(Diagnostic::error), id(0), line(0), col(0)
+{
+}
+
+potoroo::BufferResult::BufferResult()
+    : err(0), warn(0)
+{
+}
+
+//! @brief Processes a buffer in memory
+//! @param input
+//! @param name Name of the buffer, used in the diagnostics, to determine the tag and to resolve relative include paths
+//! @param options
+//! @param resolver Provides the included files
+//! @param sink Receives the output, only called if there are no errors
+//!
+//! Does not access the file system and prints nothing, the diagnostics are returned. Like a
+//! file, the output has the line ending of the input.
+//!
+BufferResult potoroo::processBuffer(std::string_view input, const std::string& name, const BufferOptions& options, const IncludeResolver& resolver, const OutputSink& sink) noexcept
+{
+    Result r;
+    vector<EWIMessage> msgs;
+    string ewiFile = name;
+
+    vector<EWIMessage>* const prevEwiCapture = ewiCapture();
+    setEwiCapture(&msgs);
+
+    try
     {
-        cout << setw(3) << i << " ";
+        ArgList args;
+        Arg a(argStr_if);
+        a.setValue(name);
+        args.add(a);
+        a = Arg(argStr_of);
+        a.setValue(name);
+        args.add(a);
+
+        if (!options.tag.empty())
+        {
+            a = Arg(argStr_tag);
+            a.setValue(options.tag);
+            args.add(a);
+        }
 
-        if (jobs[i].isValid())
+        if (options.warningAsError) args.add(Arg(argStr_wError));
+
+        Job job = Job::parseArgs(args);
+        job.setWSupList(options.wSup);
+
+        const fs::path srcFile = fs::path(name).lexically_normal();
+        ewiFile = srcFile.filename().string();
+
+        if (!job.isValid())
         {
-            cout << "\"" << jobs[i].getInputFile() << "\" " << "\"" << jobs[i].getOutputFile() << "\" " << "\"" << jobs[i].getTag() << "\"" << (jobs[i].warningAsError() ? " Werror" : "");
+            ++r.err;
+            printError(ewiFile, job.getErrorMsg());
         }
-        else cout << "invalid: " << jobs[i].getErrorMsg();
+        else
+        {
+            const char* data = input.data();
+            size_t size = input.size();
+            vector<char> dataLF;
 
-        cout << endl;
-}
-    cout << "===============" << endl;
-#endif
+            LineEndingInfo leInfo;
+            const lineEnding ile = detectLineEnding(data, size, leInfo);
 
-#if PRJ_DEBUG && 0
-    printInfo("processor", "current dir: " + pathToStr(fs::current_path()) + "\n");
-#endif
+            r += inputToLF(data, size, dataLF, ile, leInfo, job, ewiFile);
 
+            if (r.err == 0)
+            {
+                IncludeCache incCache;
+                MemIncludes memIncludes(resolver);
+                ProcContext ctx(incCache, memIncludes);
+                ProcOutput out;
 
-    Result pr;
+                r += caterpillarProc(ctx, out, data, size, srcFile, job, ewiFile);
 
-    if (jobs.size() != success.size())
+                if (job.warningAsError() && (r.warn > 0))
+                {
+                    ++r.err;
+                    printError(ewiFile, "###[@Werror@] " + to_string(r.warn) + " warnings");
+                }
+
+                if ((r.err == 0) && sink && (out.writeTo(sink, ile) != 0))
+                {
+                    ++r.err;
+                    printError(ewiFile, "convert line ending failed");
+                }
+            }
+        }
+    }
+    catch (exception& ex)
     {
-        printEWI("internal", "fatal! " + string(__FILENAME__) + ":" + to_string(__LINE__) + ": jobs.size() != success.size()", 0, 0, 0, 0);
-        ++pr.err;
+        ++r.err;
+        printError(ewiFile, ex.what());
     }
-
-    for (size_t i = 0; i < jobs.size(); ++i)
+    catch (...)
     {
-        Job j = jobs[i];
+        ++r.err;
+        printError(ewiFile, "unknown");
+    }
 
-        cout << "process " << j << endl;
+    setEwiCapture(prevEwiCapture);
 
-        incPathStack.clear();
-        incPathHistory.clear();
+    BufferResult result;
+    result.err = r.err;
+    result.warn = r.warn;
 
-        Result r = processJob(j);
-        pr += r;
+    for (size_t i = 0; i < msgs.size(); ++i)
+    {
+        Diagnostic d;
 
-        if (i < success.size())
-        {
-            success[i] = (r.err == 0);
-        }
+        if (msgs[i].ewi == 1) d.severity = Diagnostic::warning;
+        else if (msgs[i].ewi == 2) d.severity = Diagnostic::info;
+        else d.severity = Diagnostic::error;
+
+        d.id = msgs[i].id;
+        d.file = msgs[i].file;
+        d.line = msgs[i].line;
+        d.col = msgs[i].col;
+        d.message = ewiPlainText(msgs[i].text);
+
+        result.diagnostics.push_back(d);
     }
 
-    return pr;
+    return result;
 }
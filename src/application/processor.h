@@ -9,20 +9,105 @@
 #ifndef _PROCESSOR_H_
 #define _PROCESSOR_H_
 
+#include <cstdint>
+#include <filesystem>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "job.h"
+#include "stampDb.h"
 
 namespace potoroo
 {
-    const std::string processorTmpDirIncOut = "potorooTempIncProcOut";
-    const std::string processorTmpDIncLineEnding = "potorooTempDIncLineEnding"; // temporary dir for dirty include line ending conversion
-    const std::string processorTmpDirLineEnding = "potorooTempLineEnding";
+    //! @brief Processing of an included file, see JobStats
+    struct IncludeStats
+    {
+        IncludeStats();
 
-    Result processJob(const Job& job, bool forceOutfLineEndLF = false) noexcept;
-    Result processJobs(const std::vector<Job>& jobs, std::vector<bool>& success) noexcept;
+        std::filesystem::path file;
+        size_t count; // include directives
+        size_t nCached; // directives answered by the include cache
+        uint64_t ns; // time, including the nested includes
+        uint64_t bytesRead;
+    };
+
+    //! @brief Timing and sizes of a job
+    //!
+    //! Line endings are the detection and conversion of the input, the output is converted while
+    //! it's written. Scan is the processing of the input without the included files.
+    //!
+    struct JobStats
+    {
+        JobStats();
+
+        JobStats& operator+=(const JobStats& other);
+
+        bool processed; // false if skipped by --incremental
+        uint64_t nsRead;
+        uint64_t nsLineEndings;
+        uint64_t nsScan;
+        uint64_t nsInclude;
+        uint64_t nsWrite;
+        uint64_t bytesIn; // input and included files
+        uint64_t bytesOut;
+        size_t nRm;
+        size_t nEndrm;
+        size_t nRmn;
+        size_t nIns;
+        size_t nInclude;
+        size_t includeDepth; // max
+        size_t peakBufferSize; // input, converted and included data held at once
+        std::vector<IncludeStats> includes; // only per job, not in the totals
+    };
+
+    //! @brief Counters of a processJobs() run
+    struct ProcStats
+    {
+        ProcStats();
+
+        size_t nCopied; // jobs without directives, copied by the kernel
+        size_t nUnchanged; // output files left untouched because their content did not change
+        size_t nSyscallsSaved; // file system calls answered by the run wide metadata cache
+
+        bool collectJobStats; // input of processJobs(), fills jobs, total and nsWall
+        std::vector<JobStats> jobs;
+        JobStats total;
+        uint64_t nsWall; // duration of processJobs()
+    };
+
+    class ProcSession;
+
+    Result processJob(const Job& job, ProcSession* session = nullptr) noexcept;
+    Result processJobs(const std::vector<Job>& jobs, std::vector<bool>& success, size_t nThreads = 0, StampDb* stampDb = nullptr, ProcStats* stats = nullptr, ProcSession* session = nullptr) noexcept;
+
+    //! @brief State kept between calls of processJobs()
+    //!
+    //! Processed include files are reused by the following calls until they are invalidated.
+    //!
+    class ProcSession
+    {
+    public:
+        ProcSession();
+        explicit ProcSession(ProcSession& other);
+        ProcSession(const ProcSession& other) = delete;
+        ProcSession& operator=(const ProcSession& other) = delete;
+        ~ProcSession();
+
+        void invalidate(const std::filesystem::path& file);
+        void validate();
+
+        //! @brief Files included by each job of the last processJobs() call
+        std::vector<std::vector<std::filesystem::path>> deps;
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+
+        friend Result processJob(const Job& job, ProcSession* session) noexcept;
+        friend Result processJobs(const std::vector<Job>& jobs, std::vector<bool>& success, size_t nThreads, StampDb* stampDb, ProcStats* stats, ProcSession* session) noexcept;
+    };
 }
 
 #endif // _PROCESSOR_H_
@@ -0,0 +1,245 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "server.h"
+#include "middleware/localSocket.h"
+#include "middleware/util.h"
+
+namespace fs = std::filesystem;
+
+using namespace std;
+using namespace potoroo;
+
+namespace
+{
+    const string protocolId = "potoroo 1";
+
+    const char frameOutput = 'o';
+    const char frameResult = 'r';
+    const size_t frameHeaderSize = 5;
+
+    int sendFrame(LocalSocket& sock, char type, const char* data, size_t size)
+    {
+        char header[frameHeaderSize];
+        header[0] = type;
+        for (size_t i = 0; i < 4; ++i) header[i + 1] = static_cast<char>((static_cast<uint32_t>(size) >> (8 * i)) & 0xFF);
+
+        string errMsg;
+        if (sock.write(header, sizeof(header), errMsg) != 0) return 1;
+        return sock.write(data, size, errMsg);
+    }
+
+    //! @brief Sends everything written to it as output frames
+    //!
+    //! If the client has gone, the output is discarded. The request is processed anyway, so the
+    //! output files are not left half way.
+    //!
+    class FrameStreamBuf : public std::streambuf
+    {
+    public:
+        FrameStreamBuf(LocalSocket& sock)
+            : sock(sock), broken(false)
+        {
+            setp(buffer, buffer + sizeof(buffer));
+        }
+
+        ~FrameStreamBuf() { send(); }
+
+    protected:
+        int_type overflow(int_type ch) override
+        {
+            send();
+
+            if (!traits_type::eq_int_type(ch, traits_type::eof()))
+            {
+                *pptr() = traits_type::to_char_type(ch);
+                pbump(1);
+            }
+
+            return traits_type::not_eof(ch);
+        }
+
+        int sync() override
+        {
+            send();
+            return 0;
+        }
+
+    private:
+        LocalSocket& sock;
+        bool broken;
+        char buffer[4096];
+
+        void send()
+        {
+            const size_t n = static_cast<size_t>(pptr() - pbase());
+
+            if ((n > 0) && !broken) broken = (sendFrame(sock, frameOutput, pbase(), n) != 0);
+
+            setp(buffer, buffer + sizeof(buffer));
+        }
+    };
+
+    void handleConnection(shared_ptr<LocalSocket> sock, ServerRequestHandler handler)
+    {
+        string req;
+        string errMsg;
+
+        if (sock->readAll(req, errMsg) != 0) return;
+
+        vector<string> fields;
+
+        for (size_t pos = 0; pos < req.length();)
+        {
+            const size_t end = req.find('\0', pos);
+            if (end == string::npos) break;
+
+            fields.push_back(req.substr(pos, end - pos));
+            pos = end + 1;
+        }
+
+        int rc;
+        Result r;
+
+        {
+            FrameStreamBuf buf(*sock);
+            ostream os(&buf);
+
+            setEwiStream(&os);
+
+            if ((fields.size() >= 2) && (fields[0] == protocolId))
+            {
+                try { rc = handler(vector<string>(fields.begin() + 2, fields.end()), fields[1], r); }
+                catch (const std::exception& ex)
+                {
+                    printEWI("internal", "fatal! " + string(ex.what()), 0, 0, 0, 0);
+                    rc = 1;
+                    r = Result(1, 0);
+                }
+            }
+            else
+            {
+                printEWI("server", "invalid request (client of a different version?)", 0, 0, 0, 0);
+                rc = 1;
+                r = Result(1, 0);
+            }
+
+            os.flush();
+            setEwiStream(nullptr);
+        }
+
+        const string res = to_string(rc) + " " + to_string(r.err) + " " + to_string(r.warn);
+        sendFrame(*sock, frameResult, res.data(), res.length());
+    }
+}
+
+
+
+//! @brief Listens on the socket and processes the requests of the clients
+//! @param socketPath
+//! @param handler
+//! @param [out] errMsg
+//! @return Only returns on error
+//!
+//! Each connection is handled by its own thread, so clients don't wait for each other.
+//!
+int potoroo::serve(const std::string& socketPath, const ServerRequestHandler& handler, std::string& errMsg)
+{
+    LocalSocket server;
+
+    if (server.listen(socketPath, errMsg) != 0) return 1;
+
+    while (1)
+    {
+        shared_ptr<LocalSocket> client = make_shared<LocalSocket>();
+
+        if (server.accept(*client, errMsg) != 0) return 1;
+
+        thread(handleConnection, client, handler).detach();
+    }
+
+    return 0;
+}
+
+//! @brief Sends the arguments to the server and prints its output
+//! @param socketPath
+//! @param args
+//! @param [out] rc Return code of the request
+//! @param [out] errMsg
+//! @return 0 on success
+int potoroo::runClient(const std::string& socketPath, const std::vector<std::string>& args, int& rc, std::string& errMsg)
+{
+    string req = protocolId + '\0';
+
+    try { req += fs::current_path().string() + '\0'; }
+    catch (const std::exception& ex)
+    {
+        errMsg = ex.what();
+        return 1;
+    }
+
+    for (size_t i = 0; i < args.size(); ++i) req += args[i] + '\0';
+
+    LocalSocket sock;
+
+    if (sock.connect(socketPath, errMsg) != 0) return 1;
+    if (sock.write(req.data(), req.size(), errMsg) != 0) return 1;
+    sock.shutdownWrite();
+
+    string data;
+    char buffer[4096];
+    size_t n;
+
+    do
+    {
+        if (sock.read(buffer, sizeof(buffer), n, errMsg) != 0) return 1;
+        data.append(buffer, n);
+
+        size_t pos = 0;
+
+        while ((data.length() - pos) >= frameHeaderSize)
+        {
+            uint32_t size = 0;
+            for (size_t i = 0; i < 4; ++i) size |= static_cast<uint32_t>(static_cast<uint8_t>(data[pos + i + 1])) << (8 * i);
+
+            if ((data.length() - pos - frameHeaderSize) < size) break;
+
+            const char type = data[pos];
+            const char* const p = data.data() + pos + frameHeaderSize;
+
+            if (type == frameOutput) cout.write(p, size) << flush;
+            else if (type == frameResult)
+            {
+                istringstream iss(string(p, size));
+
+                if (iss >> rc) return 0;
+
+                errMsg = "invalid response";
+                return 1;
+            }
+
+            pos += frameHeaderSize + size;
+        }
+
+        data.erase(0, pos);
+    }
+    while (n > 0);
+
+    errMsg = "connection closed by the server";
+    return 1;
+}
@@ -0,0 +1,43 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "project.h"
+#include "middleware/util.h"
+
+// Protocol
+//
+// The client sends NUL terminated strings: the protocol ID, its working directory and then
+// its arguments. Then it shuts down its sending side. The server responds with frames of a
+// type byte, the data length (uint32 little endian) and the data:
+//  'o'  output to be printed by the client
+//  'r'  the request is done, data is "RC ERRORS WARNINGS", the last frame
+
+namespace potoroo
+{
+    //! @brief Processes the request of a client
+    //! @param args Command line arguments of the client, without the program name
+    //! @param cwd Working directory of the client
+    //! @param [out] r Number of errors and warnings
+    //! @return Return code of the client
+    //!
+    //! Called by a thread per connection, the messages printed to ewiStream() are sent to the client.
+    //!
+    typedef std::function<int(const std::vector<std::string>& args, const std::string& cwd, Result& r)> ServerRequestHandler;
+
+    int serve(const std::string& socketPath, const ServerRequestHandler& handler, std::string& errMsg);
+    int runClient(const std::string& socketPath, const std::vector<std::string>& args, int& rc, std::string& errMsg);
+}
+
+#endif // _SERVER_H_
@@ -0,0 +1,445 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "stampDb.h"
+#include "middleware/inputFile.h"
+
+namespace fs = std::filesystem;
+
+using namespace std;
+using namespace potoroo;
+
+namespace
+{
+    const string dbHeader = "potorooStamps";
+    const string dbFormat = "2"; // incremented if the file format changes, older files are discarded
+    const char fieldSep = '\t';
+
+    void printError(const std::string& file, const std::string& text)
+    {
+        printEWI(file, text, 0, 0, 0, 0);
+    }
+
+    void printWarning(const std::string& file, const std::string& text)
+    {
+        printEWI(file, text, 0, 0, 1, 0);
+    }
+
+    //! @brief Checks if the string can be stored in a field of the database
+    bool isStorable(const string& str)
+    {
+        return (str.find_first_of("\t\r\n") == string::npos);
+    }
+
+    string escape(const string& str)
+    {
+        string r;
+
+        for (size_t i = 0; i < str.length(); ++i)
+        {
+            if (str[i] == '\\') r += "\\\\";
+            else if (str[i] == '\t') r += "\\t";
+            else if (str[i] == '\r') r += "\\r";
+            else if (str[i] == '\n') r += "\\n";
+            else r += str[i];
+        }
+
+        return r;
+    }
+
+    string unescape(const string& str)
+    {
+        string r;
+
+        for (size_t i = 0; i < str.length(); ++i)
+        {
+            if ((str[i] == '\\') && ((i + 1) < str.length()))
+            {
+                ++i;
+
+                if (str[i] == 't') r += '\t';
+                else if (str[i] == 'r') r += '\r';
+                else if (str[i] == 'n') r += '\n';
+                else r += str[i];
+            }
+            else r += str[i];
+        }
+
+        return r;
+    }
+
+    string pathKey(const fs::path& p)
+    {
+        return p.lexically_normal().string();
+    }
+
+    //! @brief Compares the stored stamp of a file with the current one
+    //! @param file
+    //! @param [in,out] stamp Updated if the file is unchanged but its stamp is outdated
+    //! @param hashCheck
+    //! @param metaCache May be nullptr
+    //! @return true if the file is unchanged
+    bool isUnchanged(const string& file, FileStamp& stamp, bool hashCheck, FileMetaCache* metaCache)
+    {
+        FileStamp current;
+
+        if (FileStamp::get(file, current, false, metaCache) != 0) return false;
+        if (current.size != stamp.size) return false;
+        if (current.mtime == stamp.mtime) return true;
+
+        if (hashCheck && (stamp.hash != 0))
+        {
+            if ((FileStamp::get(file, current, true, metaCache) == 0) && (current.hash == stamp.hash))
+            {
+                stamp = current;
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
+
+
+
+potoroo::FileStamp::FileStamp()
+    : mtime(0), size(0), hash(0)
+{
+}
+
+//! @brief Reads the stamp of a file
+//! @param file
+//! @param [out] stamp
+//! @param hash Compute the content hash too
+//! @param metaCache May be nullptr
+//! @return 0 on success
+int potoroo::FileStamp::get(const std::filesystem::path& file, FileStamp& stamp, bool hash, FileMetaCache* metaCache)
+{
+    FileMeta meta;
+
+    if ((metaCache ? metaCache->get(file, meta) : FileMeta::get(file, meta)) != 0) return 1;
+    if (!meta.regular) return 1;
+
+    stamp.mtime = meta.mtime;
+    stamp.size = meta.size;
+
+    stamp.hash = 0;
+
+    if (hash)
+    {
+        InputFile ifile;
+
+        if (ifile.open(file) != 0) return 1;
+
+        stamp.hash = contentHash(ifile.data(), ifile.size());
+        if (stamp.hash == 0) stamp.hash = 1; // 0 means not computed
+    }
+
+    return 0;
+}
+
+
+
+potoroo::StampDb::StampDb(bool hashCheck)
+    : hashCheck(hashCheck)
+{
+}
+
+//! @brief Loads the database
+//! @param file
+//! @return Errors or warnings if the file could not be read, a missing file is not an error
+//!
+//! An invalid database or one written by another version of potoroo is discarded, every job is
+//! processed in this case.
+//!
+Result potoroo::StampDb::load(const std::filesystem::path& file)
+{
+    const string procStr = "stamp database";
+
+    lock_guard<mutex> lock(mtx);
+
+    entries.clear();
+
+    error_code ec;
+    if (!fs::exists(file, ec)) return Result();
+
+    ifstream ifs(file, ios::in | ios::binary);
+
+    if (!ifs.is_open())
+    {
+        printWarning(procStr, "could not open \"" + file.string() + "\", processing all jobs");
+        return Result(0, 1);
+    }
+
+    string line;
+
+    if (!getline(ifs, line) || (line != (dbHeader + " " + PRJ_VERSION.toString() + " " + dbFormat))) return Result();
+
+    Entry* entry = nullptr;
+    bool valid = true;
+
+    while (valid && getline(ifs, line))
+    {
+        if (line.length() < 2) valid = false;
+        else if (line[0] == 'J')
+        {
+            const size_t keyEnd = line.find(fieldSep, 2);
+            const size_t outEnd = ((keyEnd == string::npos) ? string::npos : line.find(fieldSep, keyEnd + 1));
+
+            if (outEnd == string::npos) valid = false;
+            else
+            {
+                entry = &entries[line.substr(2, outEnd - 2)];
+                entry->options = line.substr(outEnd + 1);
+                entry->nWarnings = 0;
+                entry->diag.clear();
+                entry->files.clear();
+            }
+        }
+        else if ((line[0] == 'D') && entry)
+        {
+            try { entry->nWarnings = stoi(line.substr(2)); }
+            catch (...) { valid = false; }
+        }
+        else if ((line[0] == 'M') && entry)
+        {
+            istringstream iss(line.substr(2));
+            EWIMessage msg;
+            string file, text;
+
+            iss >> msg.ewi >> msg.style >> msg.line >> msg.col >> msg.id;
+
+            if (!iss || (iss.get() != fieldSep) || !getline(iss, file, fieldSep) || !getline(iss, text)) valid = false;
+            else
+            {
+                msg.file = unescape(file);
+                msg.text = unescape(text);
+                entry->diag.push_back(msg);
+            }
+        }
+        else if ((line[0] == 'F') && entry)
+        {
+            istringstream iss(line.substr(2));
+            FileStamp stamp;
+            string path;
+
+            iss >> stamp.mtime >> stamp.size >> stamp.hash;
+
+            if (!iss || (iss.get() != fieldSep) || !getline(iss, path) || path.empty()) valid = false;
+            else entry->files.push_back(make_pair(path, stamp));
+        }
+        else valid = false;
+    }
+
+    if (!valid)
+    {
+        entries.clear();
+        printWarning(procStr, "invalid file \"" + file.string() + "\", processing all jobs");
+        return Result(0, 1);
+    }
+
+    return Result();
+}
+
+//! @brief Writes the database
+//! @param file
+//! @return Errors if the file could not be written
+//!
+//! The database is written to a temporary file which then replaces the old one, so an
+//! interrupted run never leaves a truncated database behind.
+//!
+Result potoroo::StampDb::save(const std::filesystem::path& file) const
+{
+    const string procStr = "stamp database";
+
+    lock_guard<mutex> lock(mtx);
+
+    const fs::path tmpFile = file.string() + ".tmp";
+
+    try
+    {
+        {
+            ofstream ofs;
+            ofs.exceptions(ios::failbit | ios::badbit);
+            ofs.open(tmpFile, ios::out | ios::binary | ios::trunc);
+
+            ofs << dbHeader << " " << PRJ_VERSION.toString() << " " << dbFormat << '\n';
+
+            for (auto it = entries.begin(); it != entries.end(); ++it)
+            {
+                ofs << "J " << it->first << fieldSep << it->second.options << '\n';
+                ofs << "D " << it->second.nWarnings << '\n';
+
+                for (size_t i = 0; i < it->second.diag.size(); ++i)
+                {
+                    const EWIMessage& msg = it->second.diag[i];
+                    ofs << "M " << msg.ewi << ' ' << msg.style << ' ' << msg.line << ' ' << msg.col << ' ' << msg.id << fieldSep << escape(msg.file) << fieldSep << escape(msg.text) << '\n';
+                }
+
+                for (size_t i = 0; i < it->second.files.size(); ++i)
+                {
+                    const FileStamp& stamp = it->second.files[i].second;
+                    ofs << "F " << stamp.mtime << ' ' << stamp.size << ' ' << stamp.hash << fieldSep << it->second.files[i].first << '\n';
+                }
+            }
+        }
+
+        fs::rename(tmpFile, file);
+    }
+    catch (exception& ex)
+    {
+        error_code ec;
+        fs::remove(tmpFile, ec);
+
+        printError(procStr, "could not write \"" + file.string() + "\": " + ex.what());
+        return Result(1);
+    }
+
+    return Result();
+}
+
+//! @brief Checks if the job has to be processed
+//! @param job
+//! @param [out] r Result of the recorded run
+//! @param [out] diag Diagnostics printed by the recorded run
+//! @param metaCache May be nullptr
+//! @return true if nothing changed since the last successful run of the job
+bool potoroo::StampDb::isUpToDate(const Job& job, Result& r, std::vector<EWIMessage>& diag, FileMetaCache* metaCache)
+{
+    string key, options;
+    if (!jobKey(job, key, options)) return false;
+
+    Entry entry;
+
+    {
+        lock_guard<mutex> lock(mtx);
+
+        const auto it = entries.find(key);
+        if (it == entries.end()) return false;
+        entry = it->second;
+    }
+
+    if ((entry.options != options) || (entry.files.size() < 2)) return false;
+
+    for (size_t i = 0; i < entry.files.size(); ++i)
+    {
+        if (!isUnchanged(entry.files[i].first, entry.files[i].second, hashCheck, metaCache)) return false;
+    }
+
+    // store the stamps refreshed by the hash check
+    if (hashCheck)
+    {
+        lock_guard<mutex> lock(mtx);
+        entries[key] = entry;
+    }
+
+    r = Result(0, entry.nWarnings);
+    diag = entry.diag;
+
+    return true;
+}
+
+//! @brief Records the files of a successfully processed job
+//! @param job
+//! @param deps Files included by the job
+//! @param r Result of the job
+//! @param diag Diagnostics printed by the job
+//! @param metaCache May be nullptr
+//!
+//! The entry of the job is removed if the job failed or a stamp can not be read.
+//!
+void potoroo::StampDb::update(const Job& job, const std::vector<std::filesystem::path>& deps, const Result& r, const std::vector<EWIMessage>& diag, FileMetaCache* metaCache)
+{
+    string key, options;
+    if (!jobKey(job, key, options)) return;
+
+    if (r.err != 0)
+    {
+        remove(job);
+        return;
+    }
+
+    Entry entry;
+    entry.options = options;
+    entry.nWarnings = r.warn;
+    entry.diag = diag;
+
+    vector<string> files;
+
+    try
+    {
+        files.push_back(pathKey(job.getInputPath()));
+        for (size_t i = 0; i < deps.size(); ++i) files.push_back(pathKey(deps[i]));
+        files.push_back(pathKey(job.getOutputPath()));
+    }
+    catch (...)
+    {
+        remove(job);
+        return;
+    }
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        FileStamp stamp;
+
+        if (!isStorable(files[i]) || (FileStamp::get(files[i], stamp, hashCheck, metaCache) != 0))
+        {
+            remove(job);
+            return;
+        }
+
+        entry.files.push_back(make_pair(files[i], stamp));
+    }
+
+    lock_guard<mutex> lock(mtx);
+    entries[key] = entry;
+}
+
+void potoroo::StampDb::remove(const Job& job)
+{
+    string key, options;
+    if (!jobKey(job, key, options)) return;
+
+    lock_guard<mutex> lock(mtx);
+    entries.erase(key);
+}
+
+//! @brief Builds the database key and the options string of a job
+//! @return false if the job can not be recorded
+bool potoroo::StampDb::jobKey(const Job& job, std::string& key, std::string& options)
+{
+    string inf, outf;
+
+    try
+    {
+        inf = pathKey(job.getInputPath());
+        outf = pathKey(job.getOutputPath());
+    }
+    catch (...) { return false; }
+
+    const string tag = job.getTag();
+    const string wrErrLnStr = (job.writeErrorLine() ? job.writeErrorLineStr() : string());
+
+    if (!isStorable(inf) || !isStorable(outf) || !isStorable(tag) || !isStorable(wrErrLnStr)) return false;
+
+    key = inf + fieldSep + outf;
+
+    options = to_string(static_cast<int>(job.getMode()));
+    options += fieldSep + tag;
+    options += fieldSep + string(job.warningAsError() ? "Werror" : "");
+    options += fieldSep + job.wSupListToString();
+    options += fieldSep + wrErrLnStr;
+
+    return true;
+}
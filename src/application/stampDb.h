@@ -0,0 +1,78 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#ifndef _STAMPDB_H_
+#define _STAMPDB_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "job.h"
+#include "middleware/fileMeta.h"
+#include "middleware/util.h"
+
+namespace potoroo
+{
+    //! @brief Extension appended to the jobfile name to get the stamp database file name
+    const std::string stampDbFileExt = ".stamps";
+
+    struct FileStamp
+    {
+        FileStamp();
+
+        int64_t mtime;
+        uint64_t size;
+        uint64_t hash; // 0 if not computed
+
+        static int get(const std::filesystem::path& file, FileStamp& stamp, bool hash, FileMetaCache* metaCache = nullptr);
+    };
+
+    //! @brief Persistent record of the files each job depended on in its last successful run
+    //!
+    //! A job is up to date if its options are the same and the input file, all files it
+    //! included (transitively) and the output file still have the recorded modification time
+    //! and size. With the content hash check, a file whose modification time changed is still
+    //! unchanged if its size and content hash match. The warnings of the recorded run are
+    //! stored too, so skipped jobs report the same as processed ones. Thread safe.
+    //!
+    class StampDb
+    {
+    public:
+        StampDb(bool hashCheck = false);
+
+        Result load(const std::filesystem::path& file);
+        Result save(const std::filesystem::path& file) const;
+
+        bool isUpToDate(const Job& job, Result& r, std::vector<EWIMessage>& diag, FileMetaCache* metaCache = nullptr);
+        void update(const Job& job, const std::vector<std::filesystem::path>& deps, const Result& r, const std::vector<EWIMessage>& diag, FileMetaCache* metaCache = nullptr);
+        void remove(const Job& job);
+
+    private:
+        struct Entry
+        {
+            Entry() : nWarnings(0) {}
+
+            std::string options;
+            int nWarnings;
+            std::vector<EWIMessage> diag;
+            std::vector<std::pair<std::string, FileStamp>> files;
+        };
+
+        bool hashCheck;
+        mutable std::mutex mtx;
+        std::unordered_map<std::string, Entry> entries;
+
+        static bool jobKey(const Job& job, std::string& key, std::string& options);
+    };
+}
+
+#endif // _STAMPDB_H_
@@ -0,0 +1,199 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "statsReport.h"
+#include "middleware/cliTextFormat.h"
+
+namespace fs = std::filesystem;
+
+using namespace std;
+using namespace cli;
+using namespace potoroo;
+
+namespace
+{
+    uint64_t jobTime(const JobStats& s)
+    {
+        return (s.nsRead + s.nsLineEndings + s.nsScan + s.nsInclude + s.nsWrite);
+    }
+
+    void printJobStats(ostream& os, const JobStats& s, const string& indent)
+    {
+        os << indent << "read " << formatDuration(s.nsRead);
+        os << ", line endings " << formatDuration(s.nsLineEndings);
+        os << ", scan " << formatDuration(s.nsScan);
+        os << ", include " << formatDuration(s.nsInclude);
+        os << ", write " << formatDuration(s.nsWrite);
+        os << " => " << formatDuration(jobTime(s)) << ", " << formatThroughput(s.bytesIn, jobTime(s)) << endl;
+
+        os << indent << formatBytes(s.bytesIn) << " in, " << formatBytes(s.bytesOut) << " out";
+        os << ", peak buffer " << formatBytes(s.peakBufferSize);
+        os << ", include depth " << s.includeDepth << endl;
+
+        os << indent << "directives: " << s.nRm << " rm, " << s.nEndrm << " endrm, " << s.nRmn << " rmn, " << s.nIns << " ins, " << s.nInclude << " include" << endl;
+    }
+
+    void writeJsonFields(ostream& os, const JobStats& s, const string& indent)
+    {
+        os << indent << "\"nsRead\": " << s.nsRead << ",\n";
+        os << indent << "\"nsLineEndings\": " << s.nsLineEndings << ",\n";
+        os << indent << "\"nsScan\": " << s.nsScan << ",\n";
+        os << indent << "\"nsInclude\": " << s.nsInclude << ",\n";
+        os << indent << "\"nsWrite\": " << s.nsWrite << ",\n";
+        os << indent << "\"bytesIn\": " << s.bytesIn << ",\n";
+        os << indent << "\"bytesOut\": " << s.bytesOut << ",\n";
+        os << indent << "\"directives\": { \"rm\": " << s.nRm << ", \"endrm\": " << s.nEndrm << ", \"rmn\": " << s.nRmn << ", \"ins\": " << s.nIns << ", \"include\": " << s.nInclude << " },\n";
+        os << indent << "\"includeDepth\": " << s.includeDepth << ",\n";
+        os << indent << "\"peakBufferSize\": " << s.peakBufferSize;
+    }
+}
+
+
+
+std::string potoroo::formatDuration(uint64_t ns)
+{
+    char buffer[32];
+
+    if (ns < 1000000) snprintf(buffer, sizeof(buffer), "%.1fus", static_cast<double>(ns) / 1e3);
+    else if (ns < 1000000000) snprintf(buffer, sizeof(buffer), "%.2fms", static_cast<double>(ns) / 1e6);
+    else snprintf(buffer, sizeof(buffer), "%.2fs", static_cast<double>(ns) / 1e9);
+
+    return buffer;
+}
+
+std::string potoroo::formatBytes(uint64_t n)
+{
+    char buffer[32];
+
+    if (n < 1000) snprintf(buffer, sizeof(buffer), "%uB", static_cast<unsigned>(n));
+    else if (n < 1000000) snprintf(buffer, sizeof(buffer), "%.1fkB", static_cast<double>(n) / 1e3);
+    else if (n < 1000000000) snprintf(buffer, sizeof(buffer), "%.1fMB", static_cast<double>(n) / 1e6);
+    else snprintf(buffer, sizeof(buffer), "%.2fGB", static_cast<double>(n) / 1e9);
+
+    return buffer;
+}
+
+std::string potoroo::formatThroughput(uint64_t bytes, uint64_t ns)
+{
+    if (ns == 0) return "-";
+
+    return formatBytes(static_cast<uint64_t>(static_cast<double>(bytes) * 1e9 / static_cast<double>(ns))) + "/s";
+}
+
+//! @brief Prints the statistics of each job
+//! @param os
+//! @param jobs
+//! @param stats Collected by processJobs()
+//! @param nsJobfile Time used to parse the jobfile
+void potoroo::printStats(std::ostream& os, const std::vector<Job>& jobs, const ProcStats& stats, uint64_t nsJobfile)
+{
+    os << sgr(SGRFGC_BRIGHT_WHITE) << "stats" << sgr(SGR_RESET) << endl;
+    os << "  jobfile parsed in " << formatDuration(nsJobfile) << endl;
+
+    for (size_t i = 0; (i < jobs.size()) && (i < stats.jobs.size()); ++i)
+    {
+        const JobStats& s = stats.jobs[i];
+
+        if (!jobs[i].isValid()) continue;
+
+        os << "  " << jobs[i];
+
+        if (!s.processed)
+        {
+            os << " - skipped" << endl;
+            continue;
+        }
+
+        os << endl;
+
+        printJobStats(os, s, "    ");
+
+        for (size_t j = 0; j < s.includes.size(); ++j)
+        {
+            const IncludeStats& inc = s.includes[j];
+
+            os << "    include \"" << inc.file.string() << "\" " << inc.count << "x";
+            if (inc.nCached) os << " (" << inc.nCached << " cached)";
+            os << ", " << formatDuration(inc.ns) << ", " << formatBytes(inc.bytesRead) << " read" << endl;
+        }
+    }
+
+    os << "  total (summed up, the jobs may have run in parallel)" << endl;
+    printJobStats(os, stats.total, "    ");
+}
+
+//! @brief Writes the statistics as JSON file
+//! @param file
+//! @param jobs
+//! @param stats Collected by processJobs()
+//! @param nsJobfile Time used to parse the jobfile
+Result potoroo::writeStats(const std::filesystem::path& file, const std::vector<Job>& jobs, const ProcStats& stats, uint64_t nsJobfile)
+{
+    try
+    {
+        ofstream ofs;
+        ofs.exceptions(ios::failbit | ios::badbit);
+        ofs.open(file, ios::out | ios::binary | ios::trunc);
+
+        ofs << "{\n";
+        ofs << "  \"nsJobfile\": " << nsJobfile << ",\n";
+        ofs << "  \"nsWall\": " << stats.nsWall << ",\n";
+        ofs << "  \"total\": {\n";
+        writeJsonFields(ofs, stats.total, "    ");
+        ofs << "\n  },\n";
+        ofs << "  \"jobs\": [";
+
+        bool first = true;
+
+        for (size_t i = 0; (i < jobs.size()) && (i < stats.jobs.size()); ++i)
+        {
+            const JobStats& s = stats.jobs[i];
+
+            if (!jobs[i].isValid()) continue;
+
+            ofs << (first ? "\n" : ",\n");
+            first = false;
+
+            ofs << "    {\n";
+            ofs << "      \"input\": \"" << jsonEscape(jobs[i].getInputFile()) << "\",\n";
+            ofs << "      \"output\": \"" << jsonEscape(jobs[i].getOutputFile()) << "\",\n";
+            ofs << "      \"processed\": " << (s.processed ? "true" : "false") << ",\n";
+            writeJsonFields(ofs, s, "      ");
+            ofs << ",\n      \"includes\": [";
+
+            for (size_t j = 0; j < s.includes.size(); ++j)
+            {
+                const IncludeStats& inc = s.includes[j];
+
+                ofs << ((j == 0) ? "\n" : ",\n");
+                ofs << "        { \"file\": \"" << jsonEscape(inc.file.string()) << "\", \"count\": " << inc.count << ", \"cached\": " << inc.nCached;
+                ofs << ", \"ns\": " << inc.ns << ", \"bytesRead\": " << inc.bytesRead << " }";
+            }
+
+            ofs << (s.includes.empty() ? "]\n" : "\n      ]\n");
+            ofs << "    }";
+        }
+
+        ofs << (first ? "]\n" : "\n  ]\n");
+        ofs << "}\n";
+    }
+    catch (exception& ex)
+    {
+        printEWI("stats", "could not write \"" + file.string() + "\": " + ex.what(), 0, 0, 0, 0);
+        return Result(1);
+    }
+
+    return Result();
+}
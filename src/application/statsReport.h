@@ -0,0 +1,35 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#ifndef _STATSREPORT_H_
+#define _STATSREPORT_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "job.h"
+#include "processor.h"
+#include "middleware/util.h"
+
+namespace potoroo
+{
+    //! @brief Extension appended to the jobfile name to get the file name of the --stats=json report
+    const std::string statsFileExt = ".stats.json";
+
+    std::string formatDuration(uint64_t ns);
+    std::string formatBytes(uint64_t n);
+    std::string formatThroughput(uint64_t bytes, uint64_t ns);
+
+    void printStats(std::ostream& os, const std::vector<Job>& jobs, const ProcStats& stats, uint64_t nsJobfile);
+    Result writeStats(const std::filesystem::path& file, const std::vector<Job>& jobs, const ProcStats& stats, uint64_t nsJobfile);
+}
+
+#endif // _STATSREPORT_H_
@@ -0,0 +1,77 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#ifndef _LIBPOTOROO_H_
+#define _LIBPOTOROO_H_
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Public interface of libpotoroo, only depends on the standard library.
+
+namespace potoroo
+{
+    //! @brief Options of processBuffer(), like the job options of the CLI
+    struct BufferOptions
+    {
+        BufferOptions();
+
+        //! @brief Like -t: "cpp", "bash", "batch" or "custom:CT", empty to determine it by the extension of the name
+        std::string tag;
+
+        bool warningAsError; // like -Werror
+        std::vector<int> wSup; // like -Wsup, IDs of the warnings which are not reported
+    };
+
+    struct Diagnostic
+    {
+        enum Severity
+        {
+            error,
+            warning,
+            info
+        };
+
+        Diagnostic();
+
+        Severity severity;
+        int id; // warning ID, 0 if none
+        std::string file; // name of the buffer or the included file
+        size_t line; // 0 if none
+        size_t col; // 0 if none
+        std::string message;
+    };
+
+    struct BufferResult
+    {
+        BufferResult();
+
+        int err;
+        int warn;
+        std::vector<Diagnostic> diagnostics;
+    };
+
+    //! @brief Provides the content of an included file
+    //! @param path Path of the included file, relative paths of the directive are resolved against the name of the including buffer or file
+    //! @param [out] content
+    //! @return false if the file does not exist
+    //!
+    //! Called at most once per path and call of processBuffer().
+    //!
+    typedef std::function<bool(const std::string& path, std::string& content)> IncludeResolver;
+
+    //! @brief Receives the output in pieces
+    typedef std::function<void(const char* data, size_t size)> OutputSink;
+
+    BufferResult processBuffer(std::string_view input, const std::string& name, const BufferOptions& options, const IncludeResolver& resolver, const OutputSink& sink) noexcept;
+}
+
+#endif // _LIBPOTOROO_H_
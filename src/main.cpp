@@ -6,18 +6,26 @@
 
 */
 
+#include <chrono>
 #include <cmath>
 #include <filesystem>
 #include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "project.h"
 #include "application/arg.h"
 #include "application/job.h"
 #include "application/processor.h"
+#include "application/server.h"
+#include "application/statsReport.h"
 #include "middleware/cliTextFormat.h"
+#include "middleware/fileWatcher.h"
+#include "middleware/trace.h"
 
 using namespace std;
 using namespace cli;
@@ -34,7 +42,6 @@ namespace
         rcOK = 0,
         rcInvArg,
         rcJobFileErr,
-        rcChangeWDErr,
 
         rcNErrorBase = 10,
 
@@ -48,13 +55,36 @@ namespace
         const int lwTagStr = 9;
 
         cout << "Usage:" << endl;
-        cout << "  potoroo [-jf FILE] [--force-jf]" << endl;
+        cout << "  potoroo [-jf FILE] [--force-jf] [-j N] [--incremental | --incremental-hash | --watch] [--stats[=json]] [--trace FILE]" << endl;
+        cout << "          [--diag FORMAT]" << endl;
         cout << "  potoroo -if FILE (-od DIR | -of FILE) [options]" << endl;
+        cout << "  potoroo --serve SOCKET [-j N]" << endl;
+        cout << "  potoroo --connect SOCKET (jobfile or job arguments)" << endl;
         cout << endl;
         cout << endl;
         cout << "Arguments:" << endl;
         cout << left << setw(lw) << "  " + argStr_jf + " FILE" << "specify a jobfile" << endl;
         cout << left << setw(lw) << "  " + argStr_forceJf << "force jobfile to be processed even if errors occured while parsing it" << endl;
+        cout << left << setw(lw) << "  " + argStr_jobs + " N" << "number of jobs processed in parallel (default: number of hardware threads)" << endl;
+        cout << left << setw(lw) << "  " + argStr_incremental << "skips jobs whose input, included files, options and output did not change since" << endl;
+        cout << left << setw(lw) << "  " << "their last successful run. The state is stored in FILE" + stampDbFileExt << endl;
+        cout << left << setw(lw) << "  " + argStr_incrementalHash << endl;
+        cout << left << setw(lw) << "  " << "like " + argStr_incremental + ", files with a new modification time are compared by a hash" << endl;
+        cout << left << setw(lw) << "  " << "of their content" << endl;
+        cout << left << setw(lw) << "  " + argStr_watch << "stays running and processes the jobs again whose jobfile line, input or" << endl;
+        cout << left << setw(lw) << "  " << "included files changed (Linux only)" << endl;
+        cout << left << setw(lw) << "  " + argStr_stats + "[=json]" << endl;
+        cout << left << setw(lw) << "  " << "reports the time of each processing phase, the sizes and the directives of" << endl;
+        cout << left << setw(lw) << "  " << "every job. With =json the report is written to FILE" + statsFileExt << endl;
+        cout << left << setw(lw) << "  " + argStr_trace + " FILE" << "writes a timeline of the jobfile parsing, the jobs, their phases, includes and" << endl;
+        cout << left << setw(lw) << "  " << "file operations to FILE (Chrome trace event format, for Perfetto and" << endl;
+        cout << left << setw(lw) << "  " << "chrome://tracing)" << endl;
+        cout << left << setw(lw) << "  " + argStr_diag + " FORMAT" << "format of the diagnostics: text (default), json (one object per line), sarif" << endl;
+        cout << left << setw(lw) << "  " << "(SARIF 2.1.0 log) or quiet (only the summary)" << endl;
+        cout << left << setw(lw) << "  " + argStr_serve + " SOCKET" << "runs as daemon which processes the requests of clients, included files stay" << endl;
+        cout << left << setw(lw) << "  " << "cached between the requests (Unix only)" << endl;
+        cout << left << setw(lw) << "  " + argStr_connect + " SOCKET" << endl;
+        cout << left << setw(lw) << "  " << "lets the daemon listening on SOCKET process the jobfile or job" << endl;
         cout << left << setw(lw) << "  " + argStr_if + " FILE" << "input file" << endl;
         cout << left << setw(lw) << "  " + argStr_of + " FILE" << "output file" << endl;
         cout << left << setw(lw) << "  " + argStr_od + " DIR" << "output directory (same filename)" << endl;
@@ -63,8 +93,12 @@ namespace
         cout << left << setw(lw) << "  " + argStr_wSup + " LIST" << "suppresses the reporting of the specified warnings. LIST is a comma separated" << endl;
         cout << left << setw(lw) << "  " << "list of integer warning IDs. (in processor, the jobfile parser is unaffected)" << endl;
         cout << left << setw(lw) << "  " + argStr_wrErrLn + " TEXT" << "     instead of deleting the output file on error, writes TEXT to it" << endl;
+        cout << left << setw(lw) << "  " + argStr_wrIfChanged << endl;
+        cout << left << setw(lw) << "  " << "leaves the output file untouched if its content did not change, otherwise it's" << endl;
+        cout << left << setw(lw) << "  " << "replaced atomically" << endl;
         cout << left << setw(lw) << "  " + argStr_copy << "copy, replaces the existing file only if it is older than the input file" << endl;
         cout << left << setw(lw) << "  " + argStr_copyow << "copy, overwrites the existing file" << endl;
+        cout << left << setw(lw) << "  " + argStr_copycmp << "copy, replaces the existing file only if its content differs" << endl;
         cout << endl;
         cout << left << setw(lw) << "  " + argStr_help + ", " + argStr_help_alt << "prints this help text" << endl;
         cout << left << setw(lw) << "  " + argStr_version + ", " + argStr_version_alt << "prints version info" << endl;
@@ -111,12 +145,15 @@ namespace
         cout << "This is free software. There is NO WARRANTY." << endl;
     }
 
-    void printProcessJobsResult(const Result& pr, const vector<Job>& jobs, const vector<bool>& success)
+    void printProcessJobsResult(const Result& pr, const vector<Job>& jobs, const vector<bool>& success, const ProcStats& stats)
     {
         size_t nJobs;
         size_t nSucceeded = 0;
         size_t nInvalid = 0;
 
+        // the SARIF log has no place for it
+        if (ewiFormat() == EwiFormat::sarif) return;
+
         if (jobs.size() != success.size())
         {
             printEWI("internal", "fatal! " + string(__FILENAME__) + ":" + to_string(__LINE__) + ": jobs.size() != success.size()", 0, 0, 0, 0);
@@ -133,30 +170,424 @@ namespace
 
         nJobs = jobs.size() - nInvalid;
 
+        ostream& os = ewiStream();
+
+        if (ewiFormat() == EwiFormat::jsonLines)
+        {
+            os << "{\"type\":\"summary\",\"jobs\":" << nJobs << ",\"invalid\":" << nInvalid << ",\"succeeded\":" << nSucceeded;
+            os << ",\"copied\":" << stats.nCopied << ",\"unchanged\":" << stats.nUnchanged;
+            os << ",\"errors\":" << pr.err << ",\"warnings\":" << pr.warn << "}" << endl;
+            return;
+        }
+
+        os << "========";
+
+        os << "  " << sgr(SGRFGC_BRIGHT_WHITE);
+        os << nSucceeded << "/" << nJobs;
+        if (nInvalid) os << "(" << jobs.size() << ")";
+        os << sgr(SGR_RESET) << " succeeded";
+        if (stats.nCopied || stats.nUnchanged)
+        {
+            os << " (";
+            if (stats.nCopied) os << stats.nCopied << " without directives copied";
+            if (stats.nCopied && stats.nUnchanged) os << ", ";
+            if (stats.nUnchanged) os << stats.nUnchanged << " unchanged";
+            os << ")";
+        }
+
+        os << ", ";
+        if (pr.err) os << sgr(SGRFGC_BRIGHT_RED);
+        os << pr.err;
+        if (pr.err) os << sgr(SGR_RESET);
+        os << " error";
+        if (abs(pr.err) != 1) os << "s";
+
+        os << ", ";
+        if (pr.warn) os << sgr(SGRFGC_BRIGHT_YELLOW);
+        os << pr.warn;
+        if (pr.warn) os << sgr(SGR_RESET);
+        os << " warning";
+        if (abs(pr.warn) != 1) os << "s";
+
+        if (stats.collectJobStats)
+        {
+            if (stats.nSyscallsSaved) os << ", " << stats.nSyscallsSaved << " stat calls saved";
+            os << ", " << formatBytes(stats.total.bytesIn) << " in, " << formatBytes(stats.total.bytesOut) << " out";
+            os << " in " << formatDuration(stats.nsWall) << " (" << formatThroughput(stats.total.bytesIn, stats.nsWall) << ")";
+        }
+
+        os << " ========" << endl;
+    }
+
+    //! @brief Parses and processes the jobfile
+    //! @param args
+    //! @param cwd Directory relative paths refer to, empty for the current working directory
+    //! @param nThreads Used if args don't contain -j, 0 to use the number of hardware threads
+    //! @param session May be nullptr
+    //! @param [out] pr
+    //! @return Return code
+    int runJobFile(const ArgList& args, const fs::path& cwd, size_t nThreads, ProcSession* session, Result& pr)
+    {
+        int rc;
+        const string jobfile = (cwd / args.get(ArgType::jobFile).getValue()).string();
+        vector<Job> jobs;
+
+        EwiFormat format = EwiFormat::text;
+        if (args.contains(ArgType::diag)) diagStrToFormat(format, args.get(ArgType::diag).getValue());
+
+        // the results are collected to be wrapped into the SARIF log
+        const EwiFormat prevFormat = ewiFormat();
+        ostream& os = ewiStream();
+        ostringstream sarifResults;
+
+        setEwiFormat(format);
+        if (format == EwiFormat::sarif) setEwiStream(&sarifResults);
+
+        if (args.contains(ArgType::trace)) traceStart();
+
+        const auto tParse = chrono::steady_clock::now();
+        {
+            TraceSpan span("parse jobfile", "jobfile");
+            span.arg("path", jobfile);
+            pr = Job::parseFile(jobfile, jobs);
+        }
+        const uint64_t nsJobfile = static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - tParse).count());
+
+        if ((pr.err == 0) ||
+            (args.contains(ArgType::forceJf) && (pr.err > 0)) // only force if no file IO error
+            )
+        {
+            if ((pr.err > 0) && (format == EwiFormat::text)) ewiStream() << endl;
+
+            if (args.contains(ArgType::jobs)) jobsStrToCount(nThreads, args.get(ArgType::jobs).getValue());
+
+            const bool incremental = (args.contains(ArgType::incremental) || args.contains(ArgType::incrementalHash));
+            const fs::path stampDbFile = jobfile + stampDbFileExt;
+            StampDb stampDb(args.contains(ArgType::incrementalHash));
+
+            if (incremental) pr += stampDb.load(stampDbFile);
+
+            vector<bool> success(jobs.size(), false);
+            ProcStats stats;
+            stats.collectJobStats = args.contains(ArgType::stats);
+            pr += processJobs(jobs, success, nThreads, (incremental ? &stampDb : nullptr), &stats, session);
+
+            if (incremental) pr += stampDb.save(stampDbFile);
+
+            if (stats.collectJobStats)
+            {
+                if (args.get(ArgType::stats).getValue() == "json") pr += writeStats(jobfile + statsFileExt, jobs, stats, nsJobfile);
+                else printStats(ewiStream(), jobs, stats, nsJobfile);
+            }
+
+            if (pr.err) rc = rcNErrorBase + pr.err;
+            else rc = rcOK;
+
+            printProcessJobsResult(pr, jobs, success, stats);
+        }
+        else
+        {
+            rc = rcJobFileErr;
+        }
+
+        if (args.contains(ArgType::trace))
+        {
+            string errMsg;
+
+            if (traceWrite(cwd / args.get(ArgType::trace).getValue(), errMsg) != 0)
+            {
+                printEWI(argStr_trace, errMsg, 0, 0, 0, 0);
+                ++pr.err;
+                if (rc != rcJobFileErr) rc = rcNErrorBase + pr.err;
+            }
+        }
+
+        if (format == EwiFormat::sarif)
+        {
+            setEwiStream(&os);
+            os << ewiSarifLog(sarifResults.str()) << flush;
+        }
+
+        setEwiFormat(prevFormat);
+
+        return rc;
+    }
+
+    //! @brief Processes the job given by the arguments
+    //! @param args
+    //! @param cwd Directory relative paths refer to, empty for the current working directory
+    //! @param session May be nullptr
+    //! @param [out] pr
+    //! @return Return code
+    int runSingleJob(const ArgList& args, const fs::path& cwd, ProcSession* session, Result& pr)
+    {
+        int rc;
+        Job job = Job::parseArgs(args);
+
+        if (!cwd.empty()) job.setBaseDir(cwd.string());
+
+        pr = processJob(job, session);
+
+        if (pr.err) rc = rcNErrorBase + pr.err;
+        else rc = rcOK;
+
+        if ((pr.err != 0) || (pr.warn != 0)) ewiStream() << "\n   " << pr << "\n" << endl;
+
+        return rc;
+    }
+
+    //! @brief Runs the daemon, the clients send their arguments
+    //!
+    //! The included files processed by a request are cached for the following requests, they
+    //! are checked for changes by one stat per file. Runs until the process is terminated.
+    //!
+    int serveRequests(const string& socketPath, size_t nThreads)
+    {
+        ProcSession master;
+
+        const ServerRequestHandler handler = [&master, nThreads](const vector<string>& argStrs, const string& cwd, Result& pr)
+        {
+            vector<const char*> argv(1, "potoroo");
+            for (size_t i = 0; i < argStrs.size(); ++i) argv.push_back(argStrs[i].c_str());
+
+            ArgList args = ArgList::parse(static_cast<int>(argv.size()), argv.data());
+            const ArgProcResult apr = argProc(args);
+
+            master.validate();
+            ProcSession session(master);
+
+            // the trace is process wide, requests run in parallel
+            if ((apr == ArgProcResult::loadFile) && !args.contains(ArgType::watch) && !args.contains(ArgType::trace)) return runJobFile(args, cwd, nThreads, &session, pr);
+            else if (apr == ArgProcResult::process) return runSingleJob(args, cwd, &session, pr);
+
+            pr = Result(1, 0);
+            ewiStream() << "invalid arguments" << endl;
+
+            return static_cast<int>(rcInvArg);
+        };
+
+        cout << "listening on \"" << socketPath << "\", press Ctrl+C to stop" << endl;
+
+        string errMsg;
+        serve(socketPath, handler, errMsg);
+
+        printEWI(argStr_serve, errMsg, 0, 0, 0, 0);
+
+        return rcInvArg;
+    }
+
+    //! @brief Time without further file events before the jobs are processed
+    const int watchDebounceMs = 100;
+
+    string pathKey(const fs::path& p)
+    {
+        return p.lexically_normal().string();
+    }
+
+    string jobKey(const Job& job)
+    {
+        ostringstream ss;
+        ss << job;
+        return ss.str();
+    }
+
+    //! @brief The jobfile, the inputs and the known included files of the valid jobs
+    vector<fs::path> watchFiles(const fs::path& jfPath, const vector<Job>& jobs, const vector<vector<fs::path>>& deps)
+    {
+        vector<fs::path> files(1, jfPath);
+
+        for (size_t i = 0; i < jobs.size(); ++i)
+        {
+            if (!jobs[i].isValid()) continue;
+
+            try { files.push_back(jobs[i].getInputPath()); }
+            catch (...) {}
+
+            files.insert(files.end(), deps[i].begin(), deps[i].end());
+        }
+
+        return files;
+    }
+
+    //! @brief Processes the jobfile, then waits for changes and processes the affected jobs
+    //!
+    //! Runs until the process is terminated. Jobs which failed are processed again on every
+    //! change, the file they missed may have been created.
+    //!
+    //! The known files are watched before the jobs are processed, so changes made during a pass
+    //! are reported by the next wait and start another pass. Included files which are found by
+    //! a pass are watched after it, they count as changed if they were written during the pass.
+    //!
+    int watchJobFile(const string& jobfile, bool forceJf, size_t nThreads)
+    {
+        FileWatcher watcher;
+        string errMsg;
+
+        if (watcher.open(errMsg) != 0)
+        {
+            printEWI(argStr_watch, errMsg, 0, 0, 0, 0);
+            return rcInvArg;
+        }
+
+        fs::path jfPath;
+        try { jfPath = fs::absolute(jobfile).lexically_normal(); }
+        catch (...) { jfPath = jobfile; }
+
+        ProcSession session;
+        vector<Job> jobs;
+        vector<bool> success;
+        vector<vector<fs::path>> deps;
+        vector<bool> affected;
+        bool parse = true;
+
+        while (1)
+        {
+            if (parse)
+            {
+                if (watcher.setFiles(watchFiles(jfPath, jobs, deps), errMsg) != 0)
+                {
+                    printEWI(argStr_watch, errMsg, 0, 0, 0, 0);
+                    return rcNErrorBase + 1;
+                }
+
+                vector<Job> newJobs;
+                const Result pr = Job::parseFile(jobfile, newJobs);
+
+                if ((pr.err == 0) || forceJf)
+                {
+                    if (pr.err > 0) cout << endl;
+
+                    // unchanged jobfile lines keep their state
+                    unordered_map<string, size_t> prev;
+                    for (size_t i = 0; i < jobs.size(); ++i) if (jobs[i].isValid()) prev.emplace(jobKey(jobs[i]), i);
+
+                    vector<bool> newSuccess(newJobs.size(), false);
+                    vector<vector<fs::path>> newDeps(newJobs.size());
+                    vector<bool> newAffected(newJobs.size(), true);
+
+                    for (size_t i = 0; i < newJobs.size(); ++i)
+                    {
+                        const auto it = (newJobs[i].isValid() ? prev.find(jobKey(newJobs[i])) : prev.end());
+
+                        if (it != prev.end())
+                        {
+                            newSuccess[i] = success[it->second];
+                            newDeps[i] = deps[it->second];
+                            newAffected[i] = affected[it->second];
+                        }
+                    }
+
+                    jobs = newJobs;
+                    success = newSuccess;
+                    deps = newDeps;
+                    affected = newAffected;
+                }
+                else cout << endl;
+            }
+
+            vector<Job> runJobs;
+            vector<size_t> runIdx;
+
+            for (size_t i = 0; i < jobs.size(); ++i)
+            {
+                if (affected[i])
+                {
+                    runJobs.push_back(jobs[i]);
+                    runIdx.push_back(i);
+                }
+            }
+
+            const vector<fs::path> preFiles = watchFiles(jfPath, jobs, deps);
+
+            if (watcher.setFiles(preFiles, errMsg) != 0)
+            {
+                printEWI(argStr_watch, errMsg, 0, 0, 0, 0);
+                return rcNErrorBase + 1;
+            }
+
+            // margin for the coarse clock of the file system time stamps
+            const fs::file_time_type passStart = fs::file_time_type::clock::now() - chrono::milliseconds(50);
+
+            if (runJobs.size() > 0)
+            {
+                vector<bool> runSuccess(runJobs.size(), false);
+                ProcStats stats;
+
+                const Result pr = processJobs(runJobs, runSuccess, nThreads, nullptr, &stats, &session);
+
+                for (size_t i = 0; i < runIdx.size(); ++i)
+                {
+                    success[runIdx[i]] = runSuccess[i];
+                    deps[runIdx[i]] = session.deps[i];
+                }
+
+                printProcessJobsResult(pr, runJobs, runSuccess, stats);
+            }
+
+            const vector<fs::path> files = watchFiles(jfPath, jobs, deps);
+
+            if (watcher.setFiles(files, errMsg) != 0)
+            {
+                printEWI(argStr_watch, errMsg, 0, 0, 0, 0);
+                return rcNErrorBase + 1;
+            }
+
+            // files found by this pass were not watched while it ran
+            vector<fs::path> changed;
+            unordered_set<string> preKeys;
+            for (size_t i = 0; i < preFiles.size(); ++i) preKeys.insert(pathKey(preFiles[i]));
+
+            for (size_t i = 0; i < files.size(); ++i)
+            {
+                if (preKeys.count(pathKey(files[i])) != 0) continue;
+
+                error_code ec;
+                const fs::file_time_type t = fs::last_write_time(files[i], ec);
 
+                if (!ec && (t >= passStart) && preKeys.insert(pathKey(files[i])).second) changed.push_back(files[i]);
+            }
+
+            if (changed.empty())
+            {
+                cout << endl << "watching " << watcher.count() << " files, press Ctrl+C to stop" << endl;
+
+                if (watcher.wait(changed, watchDebounceMs, errMsg) != 0)
+                {
+                    printEWI(argStr_watch, errMsg, 0, 0, 0, 0);
+                    return rcNErrorBase + 1;
+                }
+            }
+
+            cout << endl;
 
-        cout << "========";
+            unordered_set<string> changedKeys;
+            parse = false;
+
+            for (size_t i = 0; i < changed.size(); ++i)
+            {
+                cout << "changed \"" << changed[i].string() << "\"" << endl;
+
+                changedKeys.insert(pathKey(changed[i]));
+                if (pathKey(changed[i]) == pathKey(jfPath)) parse = true;
+
+                session.invalidate(changed[i]);
+            }
 
-        cout << "  " << sgr(SGRFGC_BRIGHT_WHITE);
-        cout << nSucceeded << "/" << nJobs;
-        if (nInvalid) cout << "(" << jobs.size() << ")";
-        cout << sgr(SGR_RESET) << " succeeded";
+            for (size_t i = 0; i < jobs.size(); ++i)
+            {
+                affected[i] = (jobs[i].isValid() && !success[i]);
 
-        cout << ", ";
-        if (pr.err) cout << sgr(SGRFGC_BRIGHT_RED);
-        cout << pr.err;
-        if (pr.err) cout << sgr(SGR_RESET);
-        cout << " error";
-        if (abs(pr.err) != 1) cout << "s";
+                try { if (changedKeys.count(pathKey(jobs[i].getInputPath())) != 0) affected[i] = true; }
+                catch (...) {}
 
-        cout << ", ";
-        if (pr.warn) cout << sgr(SGRFGC_BRIGHT_YELLOW);
-        cout << pr.warn;
-        if (pr.warn) cout << sgr(SGR_RESET);
-        cout << " warning";
-        if (abs(pr.warn) != 1) cout << "s";
+                for (size_t j = 0; !affected[i] && (j < deps[i].size()); ++j)
+                {
+                    if (changedKeys.count(pathKey(deps[i][j])) != 0) affected[i] = true;
+                }
+            }
+        }
 
-        cout << " ========" << endl;
+        return rcOK;
     }
 }
 
@@ -212,51 +643,47 @@ int main(int argc, char** argv)
 
     ArgProcResult apr = argProc(args);
 
-    if (apr == ArgProcResult::loadFile)
+    if ((apr == ArgProcResult::loadFile) && args.contains(ArgType::watch))
     {
-        string jobfile = args.get(ArgType::jobFile).getValue();
-        vector<Job> jobs;
-        Result pr = Job::parseFile(jobfile, jobs);
-
-        if ((pr.err == 0) ||
-            (args.contains(ArgType::forceJf) && (pr.err > 0)) // only force if no file IO error
-            )
-        {
-            Result cwdr = changeWD(fs::path(jobfile).parent_path());
-            pr += cwdr;
-
-            if (cwdr.err == 0)
-            {
-                if (pr.err > 0) cout << endl;
+        size_t nThreads = 0;
+        if (args.contains(ArgType::jobs)) jobsStrToCount(nThreads, args.get(ArgType::jobs).getValue());
 
-                vector<bool> success(jobs.size(), false);
-                pr += processJobs(jobs, success);
-
-                if (pr.err) result = rcNErrorBase + pr.err;
-                else result = rcOK;
-
-                printProcessJobsResult(pr, jobs, success);
-            }
-            else
-            {
-                result = rcChangeWDErr;
-            }
-        }
-        else
-        {
-            result = rcJobFileErr;
-        }
+        result = watchJobFile(args.get(ArgType::jobFile).getValue(), args.contains(ArgType::forceJf), nThreads);
+    }
+    else if (apr == ArgProcResult::loadFile)
+    {
+        Result pr;
+        result = runJobFile(args, "", 0, nullptr, pr);
     }
     else if (apr == ArgProcResult::process)
     {
-        Job job = Job::parseArgs(args);
+        Result pr;
+        result = runSingleJob(args, "", nullptr, pr);
+    }
+    else if (apr == ArgProcResult::serve)
+    {
+        size_t nThreads = 0;
+        if (args.contains(ArgType::jobs)) jobsStrToCount(nThreads, args.get(ArgType::jobs).getValue());
+
+        result = serveRequests(args.get(ArgType::serve).getValue(), nThreads);
+    }
+    else if (apr == ArgProcResult::connect)
+    {
+        vector<string> reqArgs;
 
-        Result pr = processJob(job);
+        for (int i = 1; i < argc; ++i)
+        {
+            if (string(argv[i]) == argStr_connect) ++i; // skip its value
+            else reqArgs.push_back(argv[i]);
+        }
 
-        if (pr.err) result = rcNErrorBase + pr.err;
-        else result = rcOK;
+        string errMsg;
 
-        if ((pr.err != 0) || (pr.warn != 0)) cout << "\n   " << pr << "\n" << endl;
+        if (runClient(args.get(ArgType::connect).getValue(), reqArgs, result, errMsg) != 0)
+        {
+            printEWI(argStr_connect, errMsg, 0, 0, 0, 0);
+            result = rcInvArg;
+        }
     }
     else if (apr == ArgProcResult::printHelp)
     {
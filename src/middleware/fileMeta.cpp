@@ -0,0 +1,200 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#include "fileMeta.h"
+#include "trace.h"
+
+#include <cerrno>
+#include <filesystem>
+#include <system_error>
+
+#if PRJ_PLAT_UNIX
+#include <sys/stat.h>
+#endif
+
+namespace fs = std::filesystem;
+
+using namespace std;
+
+
+
+FileMeta::FileMeta()
+    : exists(false), regular(false), dev(0), ino(0), mtime(0), size(0), perms(fs::perms::none)
+{
+}
+
+//! @brief Reads the metadata of a file, symlinks are followed
+//! @param file
+//! @param [out] meta
+//! @return 0 on success, also if the file does not exist (FileMeta::exists is false then)
+int FileMeta::get(const std::filesystem::path& file, FileMeta& meta)
+{
+    TraceSpan span("stat", "io");
+    if (span.active()) span.arg("path", file.string());
+
+    meta = FileMeta();
+
+#if PRJ_PLAT_UNIX
+    struct stat st;
+
+    if (::stat(file.c_str(), &st) != 0) return (((errno == ENOENT) || (errno == ENOTDIR)) ? 0 : 1);
+
+    meta.exists = true;
+    meta.regular = S_ISREG(st.st_mode);
+    meta.dev = static_cast<uint64_t>(st.st_dev);
+    meta.ino = static_cast<uint64_t>(st.st_ino);
+    meta.mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + static_cast<int64_t>(st.st_mtim.tv_nsec);
+    meta.size = static_cast<uint64_t>(st.st_size);
+    meta.perms = static_cast<fs::perms>(st.st_mode & 07777);
+#else
+    error_code ec;
+
+    const fs::file_status status = fs::status(file, ec);
+
+    if (status.type() == fs::file_type::not_found) return 0;
+    if (ec) return 1;
+
+    meta.exists = true;
+    meta.regular = (status.type() == fs::file_type::regular);
+    meta.perms = status.permissions();
+
+    const fs::file_time_type t = fs::last_write_time(file, ec);
+    if (ec) return 1;
+    meta.mtime = static_cast<int64_t>(t.time_since_epoch().count());
+
+    if (meta.regular)
+    {
+        const uintmax_t size = fs::file_size(file, ec);
+        if (ec) return 1;
+        meta.size = static_cast<uint64_t>(size);
+    }
+#endif
+
+    return 0;
+}
+
+//! @brief Checks if both paths refer to the same file
+//!
+//! Compares device and inode on Unix, otherwise the files are checked by std::filesystem.
+//!
+bool FileMeta::equivalent(const std::filesystem::path& a, const FileMeta& metaA, const std::filesystem::path& b, const FileMeta& metaB)
+{
+    if (!metaA.exists || !metaB.exists) return false;
+
+#if PRJ_PLAT_UNIX
+    (void)a;
+    (void)b;
+    return ((metaA.dev == metaB.dev) && (metaA.ino == metaB.ino));
+#else
+    error_code ec;
+    return fs::equivalent(a, b, ec);
+#endif
+}
+
+//! @brief Checks if both describe the same file with the same modification time and size
+bool FileMeta::sameState(const FileMeta& a, const FileMeta& b)
+{
+    return ((a.exists == b.exists) && (a.regular == b.regular) && (a.dev == b.dev) && (a.ino == b.ino) && (a.mtime == b.mtime) && (a.size == b.size));
+}
+
+
+
+FileMetaCache::FileMetaCache()
+    : saved(0)
+{
+}
+
+//! @brief Like FileMeta::get(), but only the first call per file reads the metadata
+//! @param file
+//! @param [out] meta
+//! @return 0 on success
+int FileMetaCache::get(const std::filesystem::path& file, FileMeta& meta)
+{
+    const string k = key(file);
+
+    {
+        lock_guard<mutex> lock(mtx);
+
+        const auto it = metas.find(k);
+
+        if (it != metas.end())
+        {
+            meta = it->second;
+            ++saved;
+            return 0;
+        }
+    }
+
+    const int r = FileMeta::get(file, meta);
+
+    if (r == 0)
+    {
+        lock_guard<mutex> lock(mtx);
+        metas.emplace(k, meta);
+    }
+
+    return r;
+}
+
+//! @brief Checks if both paths refer to the same file, false if one of them does not exist
+bool FileMetaCache::equivalent(const std::filesystem::path& a, const std::filesystem::path& b)
+{
+    FileMeta metaA, metaB;
+
+    if ((get(a, metaA) != 0) || (get(b, metaB) != 0)) return false;
+
+    return FileMeta::equivalent(a, metaA, b, metaB);
+}
+
+//! @brief Like std::filesystem::create_directories(), directories are checked once per run
+//!
+//! Throws like std::filesystem::create_directories().
+//!
+bool FileMetaCache::createDirectories(const std::filesystem::path& dir)
+{
+    const string k = key(dir);
+
+    {
+        lock_guard<mutex> lock(mtx);
+
+        if (dirs.count(k) != 0)
+        {
+            ++saved;
+            return false;
+        }
+    }
+
+    const bool created = fs::create_directories(dir);
+
+    lock_guard<mutex> lock(mtx);
+
+    dirs.insert(k);
+
+    // the directory and maybe some of its parents did not exist before
+    if (created)
+    {
+        for (fs::path p = dir; !p.empty() && (p != p.parent_path()); p = p.parent_path()) metas.erase(key(p));
+    }
+
+    return created;
+}
+
+//! @brief Forgets what is known about the file or directory
+void FileMetaCache::invalidate(const std::filesystem::path& file)
+{
+    const string k = key(file);
+
+    lock_guard<mutex> lock(mtx);
+    metas.erase(k);
+    dirs.erase(k);
+}
+
+std::string FileMetaCache::key(const std::filesystem::path& file)
+{
+    return file.lexically_normal().string();
+}
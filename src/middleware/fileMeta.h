@@ -0,0 +1,71 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#ifndef _FILEMETA_H_
+#define _FILEMETA_H_
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "project.h"
+
+//! @brief Metadata of a file, read with a single stat call
+//!
+//! Replaces the separate exists(), equivalent(), last_write_time() and file_size() calls, each
+//! of which stats the file again.
+//!
+struct FileMeta
+{
+    FileMeta();
+
+    bool exists;
+    bool regular;
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime; // nanoseconds on Unix, file_time_type ticks otherwise
+    uint64_t size;
+    std::filesystem::perms perms;
+
+    static int get(const std::filesystem::path& file, FileMeta& meta);
+    static bool equivalent(const std::filesystem::path& a, const FileMeta& metaA, const std::filesystem::path& b, const FileMeta& metaB);
+    static bool sameState(const FileMeta& a, const FileMeta& b);
+};
+
+//! @brief Run wide cache of file metadata and existing directories
+//!
+//! Files are stat'ed once per run, no matter how many jobs ask for them. Files which are
+//! written or removed during the run have to be invalidated. Thread safe.
+//!
+class FileMetaCache
+{
+public:
+    FileMetaCache();
+
+    int get(const std::filesystem::path& file, FileMeta& meta);
+    bool equivalent(const std::filesystem::path& a, const std::filesystem::path& b);
+    bool createDirectories(const std::filesystem::path& dir);
+    void invalidate(const std::filesystem::path& file);
+
+    //! @brief Number of system calls answered by the cache
+    size_t nSaved() const { return saved; }
+
+private:
+    std::mutex mtx;
+    std::unordered_map<std::string, FileMeta> metas;
+    std::unordered_set<std::string> dirs; // created or known to exist
+    std::atomic<size_t> saved;
+
+    static std::string key(const std::filesystem::path& file);
+};
+
+#endif // _FILEMETA_H_
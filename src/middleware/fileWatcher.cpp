@@ -0,0 +1,257 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#include "fileWatcher.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#if PRJ_PLAT_UNIX && defined(__linux__)
+#define FILEWATCHER_INOTIFY (1)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+using namespace std;
+
+namespace
+{
+#if FILEWATCHER_INOTIFY
+    const uint32_t watchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ATTRIB;
+
+    //! @brief Waits for the inotify fd to become readable
+    //! @return 1 if readable, 0 on timeout, -1 on error
+    int pollFd(int fd, int timeoutMs)
+    {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        int res;
+        do { res = poll(&pfd, 1, timeoutMs); }
+        while ((res < 0) && (errno == EINTR));
+
+        return ((res > 0) ? 1 : res);
+    }
+#endif
+}
+
+
+
+FileWatcher::FileWatcher()
+    : fd(-1)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    close();
+}
+
+//! @brief Initializes the watcher
+//! @param [out] errMsg
+//! @return 0 on success
+int FileWatcher::open(std::string& errMsg)
+{
+    close();
+    errMsg.clear();
+
+#if FILEWATCHER_INOTIFY
+    fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+
+    if (fd < 0)
+    {
+        errMsg = "inotify_init1 failed: " + string(strerror(errno));
+        return 1;
+    }
+
+    return 0;
+#else
+    errMsg = "not supported on this platform";
+    return 1;
+#endif
+}
+
+void FileWatcher::close()
+{
+#if FILEWATCHER_INOTIFY
+    if (fd >= 0) ::close(fd);
+#endif
+
+    fd = -1;
+    dirs.clear();
+    files.clear();
+}
+
+//! @brief Replaces the set of watched files
+//! @param files
+//! @param [out] errMsg
+//! @return 0 on success
+//!
+//! Files in directories which do not exist are ignored.
+//!
+int FileWatcher::setFiles(const std::vector<std::filesystem::path>& files, std::string& errMsg)
+{
+    this->files.clear();
+
+#if FILEWATCHER_INOTIFY
+    if (fd < 0)
+    {
+        errMsg = "not open";
+        return 1;
+    }
+
+    unordered_set<string> dirKeys;
+    unordered_map<int, fs::path> newDirs;
+
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        const fs::path file = files[i].lexically_normal();
+        const fs::path dir = file.parent_path();
+
+        this->files.insert(key(file));
+
+        if (!dirKeys.insert(key(dir)).second) continue;
+
+        // adding an already watched directory returns its watch descriptor
+        const int wd = inotify_add_watch(fd, dir.c_str(), watchMask);
+
+        if (wd >= 0) newDirs[wd] = dir;
+        else if ((errno != ENOENT) && (errno != ENOTDIR))
+        {
+            errMsg = "could not watch \"" + dir.string() + "\": " + string(strerror(errno));
+            return 1;
+        }
+    }
+
+    for (const auto& d : dirs)
+    {
+        if (newDirs.count(d.first) == 0) inotify_rm_watch(fd, d.first);
+    }
+
+    dirs = newDirs;
+
+    return 0;
+#else
+    (void)files;
+    errMsg = "not supported on this platform";
+    return 1;
+#endif
+}
+
+//! @brief Number of watched files
+size_t FileWatcher::count() const
+{
+    return files.size();
+}
+
+//! @brief Blocks until at least one of the watched files changed
+//! @param [out] changed The changed files
+//! @param debounceMs Events are collected until there were none for this duration
+//! @param [out] errMsg
+//! @return 0 on success
+int FileWatcher::wait(std::vector<std::filesystem::path>& changed, int debounceMs, std::string& errMsg)
+{
+    changed.clear();
+
+#if FILEWATCHER_INOTIFY
+    if (fd < 0)
+    {
+        errMsg = "not open";
+        return 1;
+    }
+
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    unordered_set<string> changedKeys;
+    bool overflow = false;
+
+    int timeoutMs = -1;
+
+    while (1)
+    {
+        const int res = pollFd(fd, timeoutMs);
+
+        if (res < 0)
+        {
+            errMsg = "poll failed: " + string(strerror(errno));
+            return 1;
+        }
+        else if (res == 0) break; // quiet for debounceMs
+
+        const ssize_t n = read(fd, buffer, sizeof(buffer));
+
+        if (n < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EINTR)) continue;
+
+            errMsg = "read failed: " + string(strerror(errno));
+            return 1;
+        }
+
+        for (ssize_t i = 0; i < n;)
+        {
+            const struct inotify_event* ev = reinterpret_cast<const struct inotify_event*>(buffer + i);
+            i += sizeof(struct inotify_event) + ev->len;
+
+            if (ev->mask & IN_Q_OVERFLOW) overflow = true;
+            else if (ev->mask & IN_IGNORED) dirs.erase(ev->wd);
+            else if (ev->len > 0)
+            {
+                const auto it = dirs.find(ev->wd);
+
+                if (it != dirs.end())
+                {
+                    const fs::path file = it->second / ev->name;
+                    const string k = key(file);
+
+                    if ((files.count(k) != 0) && changedKeys.insert(k).second) changed.push_back(file);
+                }
+            }
+        }
+
+        // events of other files in the watched directories don't start the debounce timer
+        if (!changed.empty() || overflow) timeoutMs = debounceMs;
+    }
+
+    // events got lost, everything may have changed
+    if (overflow)
+    {
+        changed.clear();
+        for (const string& f : files) changed.push_back(f);
+    }
+
+    return 0;
+#else
+    (void)debounceMs;
+    errMsg = "not supported on this platform";
+    return 1;
+#endif
+}
+
+bool FileWatcher::supported()
+{
+#if FILEWATCHER_INOTIFY
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::string FileWatcher::key(const std::filesystem::path& file)
+{
+    return file.lexically_normal().string();
+}
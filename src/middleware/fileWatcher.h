@@ -0,0 +1,52 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#ifndef _FILEWATCHER_H_
+#define _FILEWATCHER_H_
+
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "project.h"
+
+//! @brief Waits for changes of a set of files
+//!
+//! The directories of the files are watched instead of the files themselves, so files which
+//! are replaced (written to a temporary file and renamed, like many editors do) are still
+//! recognized. Uses inotify, not supported on other platforms.
+//!
+class FileWatcher
+{
+public:
+    FileWatcher();
+    FileWatcher(const FileWatcher& other) = delete;
+    FileWatcher& operator=(const FileWatcher& other) = delete;
+    ~FileWatcher();
+
+    int open(std::string& errMsg);
+    void close();
+
+    int setFiles(const std::vector<std::filesystem::path>& files, std::string& errMsg);
+    size_t count() const;
+
+    int wait(std::vector<std::filesystem::path>& changed, int debounceMs, std::string& errMsg);
+
+    static bool supported();
+
+private:
+    int fd;
+    std::unordered_map<int, std::filesystem::path> dirs; // watch descriptor -> directory
+    std::unordered_set<std::string> files;
+
+    static std::string key(const std::filesystem::path& file);
+};
+
+#endif // _FILEWATCHER_H_
@@ -0,0 +1,257 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#include "inputFile.h"
+#include "trace.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if PRJ_PLAT_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+using namespace std;
+
+namespace
+{
+    //! @brief Block size of buffered reads
+    const size_t readBlockSize = 256 * 1024;
+}
+
+
+
+InputFile::InputFile()
+    : d(nullptr), n(0), opened(false), map(nullptr), mapSize(0)
+{
+}
+
+InputFile::~InputFile()
+{
+    close();
+}
+
+int InputFile::open(const std::filesystem::path& filepath)
+{
+    string deadEnd;
+    return open(filepath, deadEnd);
+}
+
+//! @brief Opens the file and makes its whole content available through data()
+//! @param filepath
+//! @param [out] errMsg
+//! @return 0 on success
+int InputFile::open(const std::filesystem::path& filepath, std::string& errMsg)
+{
+    return open(filepath, errMsg, true);
+}
+
+//! @brief Like open(), but the file is never mapped
+//! @param filepath
+//! @param [out] errMsg
+//! @return 0 on success
+//!
+//! For data which is used longer than the file is opened by the process. A mapping can fault
+//! (SIGBUS) if the file is truncated by someone else.
+//!
+int InputFile::read(const std::filesystem::path& filepath, std::string& errMsg)
+{
+    return open(filepath, errMsg, false);
+}
+
+int InputFile::open(const std::filesystem::path& filepath, std::string& errMsg, bool mapFile)
+{
+    int r = 0;
+
+    close();
+    errMsg.clear();
+
+    TraceSpan span("read file", "io");
+    if (span.active()) span.arg("path", filepath.string());
+
+#if PRJ_PLAT_UNIX
+    const int fd = ::open(filepath.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0)
+    {
+        errMsg = "could not open file: " + string(strerror(errno));
+        return 1;
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0)
+    {
+        errMsg = "could not stat file: " + string(strerror(errno));
+        r = 1;
+    }
+    else if (S_ISREG(st.st_mode) && (st.st_size > 0) && !mapFile)
+    {
+        buffer.reserve(static_cast<size_t>(st.st_size) + readBlockSize);
+        r = readBuffered(fd, errMsg);
+    }
+    else if (S_ISREG(st.st_mode) && (st.st_size > 0))
+    {
+        void* const m = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (m != MAP_FAILED)
+        {
+            map = m;
+            mapSize = static_cast<size_t>(st.st_size);
+            d = static_cast<const char*>(m);
+            n = mapSize;
+
+#ifdef MADV_SEQUENTIAL
+            madvise(map, mapSize, MADV_SEQUENTIAL);
+#endif
+#ifdef MADV_WILLNEED
+            madvise(map, mapSize, MADV_WILLNEED);
+#endif
+        }
+        else r = readBuffered(fd, errMsg);
+    }
+    else if (S_ISREG(st.st_mode))
+    {
+        // empty regular file, but procfs and friends report a size of 0 too
+        r = readBuffered(fd, errMsg);
+    }
+    else if (S_ISDIR(st.st_mode))
+    {
+        errMsg = "is a directory";
+        r = 1;
+    }
+    else r = readBuffered(fd, errMsg);
+
+    ::close(fd);
+#else
+    (void)mapFile;
+    r = readBuffered(filepath, errMsg);
+#endif
+
+    if (r == 0)
+    {
+        opened = true;
+
+        // mapped files are read by the page faults of the first access
+        span.arg("size", static_cast<uint64_t>(n));
+        span.arg("mapped", (isMapped() ? 1u : 0u));
+    }
+    else close();
+
+    return r;
+}
+
+void InputFile::close()
+{
+#if PRJ_PLAT_UNIX
+    if (map) munmap(map, mapSize);
+#endif
+
+    map = nullptr;
+    mapSize = 0;
+    buffer.clear();
+    buffer.shrink_to_fit();
+    d = nullptr;
+    n = 0;
+    opened = false;
+}
+
+const char* InputFile::data() const
+{
+    return d;
+}
+
+size_t InputFile::size() const
+{
+    return n;
+}
+
+bool InputFile::isOpen() const
+{
+    return opened;
+}
+
+bool InputFile::isMapped() const
+{
+    return (map != nullptr);
+}
+
+#if PRJ_PLAT_UNIX
+int InputFile::readBuffered(int fd, std::string& errMsg)
+{
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    size_t nRead = 0;
+
+    while (1)
+    {
+        if ((buffer.size() - nRead) < readBlockSize) buffer.resize(nRead + readBlockSize);
+
+        const ssize_t res = ::read(fd, buffer.data() + nRead, buffer.size() - nRead);
+
+        if (res > 0) nRead += static_cast<size_t>(res);
+        else if (res == 0) break;
+        else if (errno != EINTR)
+        {
+            errMsg = "read failed: " + string(strerror(errno));
+            return 1;
+        }
+    }
+
+    buffer.resize(nRead);
+    d = buffer.data();
+    n = buffer.size();
+
+    return 0;
+}
+#else
+int InputFile::readBuffered(const std::filesystem::path& filepath, std::string& errMsg)
+{
+    ifstream ifs;
+
+    ifs.open(filepath, ios::in | ios::binary);
+
+    if (!ifs.is_open())
+    {
+        errMsg = "could not open file";
+        return 1;
+    }
+
+    size_t nRead = 0;
+
+    while (ifs.good())
+    {
+        buffer.resize(nRead + readBlockSize);
+        ifs.read(buffer.data() + nRead, readBlockSize);
+        nRead += static_cast<size_t>(ifs.gcount());
+    }
+
+    if (ifs.bad())
+    {
+        errMsg = "read failed";
+        return 1;
+    }
+
+    buffer.resize(nRead);
+    d = buffer.data();
+    n = buffer.size();
+
+    return 0;
+}
+#endif
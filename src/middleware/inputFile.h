@@ -0,0 +1,61 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#ifndef _INPUTFILE_H_
+#define _INPUTFILE_H_
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "project.h"
+
+//! @brief Read only view of the whole content of a file
+//!
+//! Regular files are memory mapped and the kernel is advised to read ahead sequentially.
+//! Pipes, special files and files which can not be mapped are read with large buffered
+//! reads into an owned buffer instead.
+//!
+class InputFile
+{
+public:
+    InputFile();
+    InputFile(const InputFile& other) = delete;
+    InputFile& operator=(const InputFile& other) = delete;
+    ~InputFile();
+
+    int open(const std::filesystem::path& filepath);
+    int open(const std::filesystem::path& filepath, std::string& errMsg);
+    int read(const std::filesystem::path& filepath, std::string& errMsg);
+    void close();
+
+    const char* data() const;
+    size_t size() const;
+
+    bool isOpen() const;
+    bool isMapped() const;
+
+private:
+    const char* d;
+    size_t n;
+    bool opened;
+
+    void* map;
+    size_t mapSize;
+    std::vector<char> buffer;
+
+    int open(const std::filesystem::path& filepath, std::string& errMsg, bool mapFile);
+
+#if PRJ_PLAT_UNIX
+    int readBuffered(int fd, std::string& errMsg);
+#else
+    int readBuffered(const std::filesystem::path& filepath, std::string& errMsg);
+#endif
+};
+
+#endif // _INPUTFILE_H_
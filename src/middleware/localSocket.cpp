@@ -0,0 +1,294 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#include "localSocket.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+#if PRJ_PLAT_UNIX
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+using namespace std;
+
+namespace
+{
+#if PRJ_PLAT_UNIX
+    //! @return 0 on success
+    int makeAddr(const fs::path& path, struct sockaddr_un& addr, string& errMsg)
+    {
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+
+        const string p = path.string();
+
+        if (p.empty() || (p.length() >= sizeof(addr.sun_path)))
+        {
+            errMsg = "invalid socket path (max " + to_string(sizeof(addr.sun_path) - 1) + " characters)";
+            return 1;
+        }
+
+        memcpy(addr.sun_path, p.c_str(), p.length());
+
+        return 0;
+    }
+#endif
+}
+
+
+
+LocalSocket::LocalSocket()
+    : fd(-1)
+{
+}
+
+LocalSocket::~LocalSocket()
+{
+    close();
+}
+
+//! @brief Creates the socket file and listens on it
+//! @param path
+//! @param [out] errMsg
+//! @return 0 on success
+//!
+//! A stale socket file, which nobody listens on any more, is replaced.
+//!
+int LocalSocket::listen(const std::filesystem::path& path, std::string& errMsg)
+{
+    close();
+    errMsg.clear();
+
+#if PRJ_PLAT_UNIX
+    struct sockaddr_un addr;
+    if (makeAddr(path, addr, errMsg) != 0) return 1;
+
+    {
+        LocalSocket probe;
+        string deadEnd;
+
+        if (probe.connect(path, deadEnd) == 0)
+        {
+            errMsg = "\"" + path.string() + "\" is already in use";
+            return 1;
+        }
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0)
+    {
+        errMsg = "could not create socket: " + string(strerror(errno));
+        return 1;
+    }
+
+    ::unlink(addr.sun_path);
+
+    if ((::bind(fd, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr)) != 0) || (::listen(fd, SOMAXCONN) != 0))
+    {
+        errMsg = "could not listen on \"" + path.string() + "\": " + string(strerror(errno));
+        close();
+        return 1;
+    }
+
+    boundPath = path;
+
+    return 0;
+#else
+    (void)path;
+    errMsg = "not supported on this platform";
+    return 1;
+#endif
+}
+
+//! @brief Waits for a connection
+//! @param [out] client The connection
+//! @param [out] errMsg
+//! @return 0 on success
+int LocalSocket::accept(LocalSocket& client, std::string& errMsg)
+{
+    client.close();
+
+#if PRJ_PLAT_UNIX
+    int res;
+    do { res = ::accept4(fd, nullptr, nullptr, SOCK_CLOEXEC); }
+    while ((res < 0) && ((errno == EINTR) || (errno == ECONNABORTED)));
+
+    if (res < 0)
+    {
+        errMsg = "accept failed: " + string(strerror(errno));
+        return 1;
+    }
+
+    client.fd = res;
+
+    return 0;
+#else
+    errMsg = "not supported on this platform";
+    return 1;
+#endif
+}
+
+//! @brief Connects to a listening socket
+//! @param path
+//! @param [out] errMsg
+//! @return 0 on success
+int LocalSocket::connect(const std::filesystem::path& path, std::string& errMsg)
+{
+    close();
+    errMsg.clear();
+
+#if PRJ_PLAT_UNIX
+    struct sockaddr_un addr;
+    if (makeAddr(path, addr, errMsg) != 0) return 1;
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (fd < 0)
+    {
+        errMsg = "could not create socket: " + string(strerror(errno));
+        return 1;
+    }
+
+    if (::connect(fd, reinterpret_cast<const struct sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+        errMsg = "could not connect to \"" + path.string() + "\": " + string(strerror(errno));
+        close();
+        return 1;
+    }
+
+    return 0;
+#else
+    (void)path;
+    errMsg = "not supported on this platform";
+    return 1;
+#endif
+}
+
+void LocalSocket::close()
+{
+#if PRJ_PLAT_UNIX
+    if (fd >= 0) ::close(fd);
+
+    if (!boundPath.empty()) ::unlink(boundPath.c_str());
+#endif
+
+    fd = -1;
+    boundPath.clear();
+}
+
+//! @brief Writes all the data
+//! @return 0 on success
+int LocalSocket::write(const char* data, size_t size, std::string& errMsg)
+{
+#if PRJ_PLAT_UNIX
+    while (size > 0)
+    {
+        // no SIGPIPE if the peer has gone
+        const ssize_t res = ::send(fd, data, size, MSG_NOSIGNAL);
+
+        if (res < 0)
+        {
+            if (errno == EINTR) continue;
+
+            errMsg = "write failed: " + string(strerror(errno));
+            return 1;
+        }
+
+        data += res;
+        size -= static_cast<size_t>(res);
+    }
+
+    return 0;
+#else
+    (void)data;
+    (void)size;
+    errMsg = "not supported on this platform";
+    return 1;
+#endif
+}
+
+//! @brief Reads what is available, at least one byte
+//! @param data
+//! @param size
+//! @param [out] nRead 0 if the peer closed the connection
+//! @param [out] errMsg
+//! @return 0 on success
+int LocalSocket::read(char* data, size_t size, size_t& nRead, std::string& errMsg)
+{
+    nRead = 0;
+
+#if PRJ_PLAT_UNIX
+    ssize_t res;
+    do { res = ::read(fd, data, size); }
+    while ((res < 0) && (errno == EINTR));
+
+    if (res < 0)
+    {
+        errMsg = "read failed: " + string(strerror(errno));
+        return 1;
+    }
+
+    nRead = static_cast<size_t>(res);
+
+    return 0;
+#else
+    (void)data;
+    (void)size;
+    errMsg = "not supported on this platform";
+    return 1;
+#endif
+}
+
+//! @brief Reads until the peer shuts down its side of the connection
+//! @return 0 on success
+int LocalSocket::readAll(std::string& data, std::string& errMsg)
+{
+    data.clear();
+
+    char buffer[4096];
+    size_t n;
+
+    do
+    {
+        if (read(buffer, sizeof(buffer), n, errMsg) != 0) return 1;
+        data.append(buffer, n);
+    }
+    while (n > 0);
+
+    return 0;
+}
+
+//! @brief Signals the end of the data to the peer
+void LocalSocket::shutdownWrite()
+{
+#if PRJ_PLAT_UNIX
+    if (fd >= 0) ::shutdown(fd, SHUT_WR);
+#endif
+}
+
+bool LocalSocket::isOpen() const
+{
+    return (fd >= 0);
+}
+
+bool LocalSocket::supported()
+{
+#if PRJ_PLAT_UNIX
+    return true;
+#else
+    return false;
+#endif
+}
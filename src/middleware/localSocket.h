@@ -0,0 +1,49 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#ifndef _LOCALSOCKET_H_
+#define _LOCALSOCKET_H_
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+
+#include "project.h"
+
+//! @brief Stream socket in the file system (Unix domain socket)
+//!
+//! Not supported on other platforms, all functions fail there.
+//!
+class LocalSocket
+{
+public:
+    LocalSocket();
+    LocalSocket(const LocalSocket& other) = delete;
+    LocalSocket& operator=(const LocalSocket& other) = delete;
+    ~LocalSocket();
+
+    int listen(const std::filesystem::path& path, std::string& errMsg);
+    int accept(LocalSocket& client, std::string& errMsg);
+    int connect(const std::filesystem::path& path, std::string& errMsg);
+    void close();
+
+    int write(const char* data, size_t size, std::string& errMsg);
+    int read(char* data, size_t size, size_t& nRead, std::string& errMsg);
+    int readAll(std::string& data, std::string& errMsg);
+    void shutdownWrite();
+
+    bool isOpen() const;
+
+    static bool supported();
+
+private:
+    int fd;
+    std::filesystem::path boundPath; // removed on close
+};
+
+#endif // _LOCALSOCKET_H_
@@ -0,0 +1,433 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#include "outputFile.h"
+#include "trace.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#if PRJ_PLAT_UNIX
+#include <climits>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+#endif
+
+namespace fs = std::filesystem;
+
+using namespace std;
+
+namespace
+{
+#if PRJ_PLAT_UNIX
+#ifdef IOV_MAX
+    const size_t maxIovCount = ((IOV_MAX < 1024) ? IOV_MAX : 1024);
+#else
+    const size_t maxIovCount = 16;
+#endif
+#endif
+
+    atomic<unsigned> tmpCounter(0);
+
+    //! @brief Path of a temporary file in the same directory, so it can be renamed to dst
+    fs::path tmpFilePath(const fs::path& dst)
+    {
+        string name = "." + dst.filename().string() + ".potoroo-";
+#if PRJ_PLAT_UNIX
+        name += to_string(getpid()) + "-";
+#endif
+        name += to_string(tmpCounter.fetch_add(1));
+
+        return dst.parent_path() / name;
+    }
+}
+
+
+
+OutputFile::OutputFile()
+#if PRJ_PLAT_UNIX
+    : fd(-1)
+#endif
+{
+}
+
+OutputFile::~OutputFile()
+{
+    discard();
+}
+
+//! @brief Creates or truncates the file
+//! @param filepath
+//! @param [out] errMsg
+//! @return 0 on success
+int OutputFile::open(const std::filesystem::path& filepath, std::string& errMsg)
+{
+    discard();
+    errMsg.clear();
+
+    TraceSpan span("open output", "io");
+    if (span.active()) span.arg("path", filepath.string());
+
+#if PRJ_PLAT_UNIX
+    fd = ::open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+
+    if (fd < 0)
+    {
+        errMsg = "could not open file: " + string(strerror(errno));
+        return 1;
+    }
+#else
+    ofs.open(filepath, ios::out | ios::binary | ios::trunc);
+
+    if (!ofs.is_open())
+    {
+        errMsg = "could not open file";
+        return 1;
+    }
+#endif
+
+    return 0;
+}
+
+//! @brief Opens a temporary file which replaces filepath on close()
+//! @param filepath
+//! @param [out] errMsg
+//! @return 0 on success
+//!
+//! The temporary file gets the permissions of the existing file. A symbolic link is resolved,
+//! so its target is replaced and the link is kept. If the destination is not a regular file or
+//! has more than one hard link, it's opened by open() and written in place, because a rename
+//! would replace it by a new regular file.
+//!
+int OutputFile::openReplace(const std::filesystem::path& filepath, std::string& errMsg)
+{
+    discard();
+    errMsg.clear();
+
+    error_code ec;
+    fs::path dst = filepath;
+
+    if (fs::is_symlink(filepath, ec))
+    {
+        dst = fs::weakly_canonical(filepath, ec);
+        if (ec || fs::is_symlink(dst, ec)) return open(filepath, errMsg); // dangling link
+    }
+
+#if PRJ_PLAT_UNIX
+    struct stat st;
+    const bool dstExists = (::stat(dst.c_str(), &st) == 0);
+
+    if (dstExists && (!S_ISREG(st.st_mode) || (st.st_nlink > 1))) return open(filepath, errMsg);
+#else
+    const fs::file_status dstStatus = fs::status(dst, ec);
+
+    if (fs::exists(dstStatus) && (!fs::is_regular_file(dstStatus) || (fs::hard_link_count(dst, ec) > 1))) return open(filepath, errMsg);
+#endif
+
+    TraceSpan span("open output (replace)", "io");
+    if (span.active()) span.arg("path", filepath.string());
+
+#if PRJ_PLAT_UNIX
+    for (int i = 0; (fd < 0) && (i < 100); ++i)
+    {
+        tmpPath = tmpFilePath(dst);
+        fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+
+        if ((fd < 0) && (errno != EEXIST)) break;
+    }
+
+    if (fd < 0)
+    {
+        errMsg = "could not create temporary file: " + string(strerror(errno));
+        tmpPath.clear();
+        return 1;
+    }
+
+    if (dstExists) (void)fchmod(fd, st.st_mode & 07777);
+#else
+    do { tmpPath = tmpFilePath(dst); }
+    while (fs::exists(tmpPath, ec));
+
+    ofs.open(tmpPath, ios::out | ios::binary | ios::trunc);
+
+    if (!ofs.is_open())
+    {
+        errMsg = "could not create temporary file";
+        tmpPath.clear();
+        return 1;
+    }
+#endif
+
+    dstPath = dst;
+
+    return 0;
+}
+
+//! @brief Closes the file
+//! @param [out] errMsg
+//! @return 0 on success or if the file was not open
+//!
+//! A file opened by openReplace() is renamed to its destination, or removed if that fails.
+//!
+int OutputFile::close(std::string& errMsg)
+{
+    int r = 0;
+
+    if (!isOpen() && tmpPath.empty()) return 0;
+
+    TraceSpan span("close output", "io");
+
+#if PRJ_PLAT_UNIX
+    if (fd >= 0)
+    {
+        if (::close(fd) != 0)
+        {
+            errMsg = "close failed: " + string(strerror(errno));
+            r = 1;
+        }
+
+        fd = -1;
+    }
+#else
+    if (ofs.is_open())
+    {
+        ofs.close();
+
+        if (ofs.fail())
+        {
+            errMsg = "close failed";
+            r = 1;
+        }
+    }
+#endif
+
+    if (!tmpPath.empty())
+    {
+        error_code ec;
+
+        if (r == 0)
+        {
+            fs::rename(tmpPath, dstPath, ec);
+
+            if (ec)
+            {
+                errMsg = "could not replace file: " + ec.message();
+                r = 1;
+            }
+        }
+
+        if (r != 0) fs::remove(tmpPath, ec);
+
+        tmpPath.clear();
+    }
+
+    return r;
+}
+
+//! @brief Closes the file, a file opened by openReplace() is removed instead of replacing its destination
+void OutputFile::discard()
+{
+    string deadEnd;
+
+    if (!tmpPath.empty())
+    {
+        const fs::path tmp = tmpPath;
+        tmpPath.clear();
+
+        close(deadEnd);
+
+        error_code ec;
+        fs::remove(tmp, ec);
+    }
+    else close(deadEnd);
+}
+
+int OutputFile::write(const char* data, size_t size, std::string& errMsg)
+{
+    const OutputSpan span = { data, size };
+    return write(&span, 1, errMsg);
+}
+
+//! @brief Writes the spans one after the other
+//! @param spans
+//! @param count
+//! @param [out] errMsg
+//! @return 0 on success
+int OutputFile::write(const OutputSpan* spans, size_t count, std::string& errMsg)
+{
+    TraceSpan span("write", "io");
+
+    if (span.active())
+    {
+        uint64_t size = 0;
+        for (size_t i = 0; i < count; ++i) size += spans[i].size;
+        span.arg("size", size);
+    }
+
+    if (!isOpen())
+    {
+        errMsg = "file not open";
+        return 1;
+    }
+
+#if PRJ_PLAT_UNIX
+    struct iovec iov[maxIovCount];
+    size_t i = 0;
+
+    while (i < count)
+    {
+        size_t n = 0;
+
+        while ((n < maxIovCount) && ((i + n) < count))
+        {
+            iov[n].iov_base = const_cast<char*>(spans[i + n].data);
+            iov[n].iov_len = spans[i + n].size;
+            ++n;
+        }
+
+        i += n;
+
+        // write the batch, partial writes continue where they stopped
+        struct iovec* pIov = iov;
+
+        while (n > 0)
+        {
+            const ssize_t res = ::writev(fd, pIov, static_cast<int>(n));
+
+            if (res < 0)
+            {
+                if (errno == EINTR) continue;
+
+                errMsg = "write failed: " + string(strerror(errno));
+                return 1;
+            }
+
+            size_t written = static_cast<size_t>(res);
+
+            while ((n > 0) && (written >= pIov->iov_len))
+            {
+                written -= pIov->iov_len;
+                ++pIov;
+                --n;
+            }
+
+            if (n > 0)
+            {
+                pIov->iov_base = static_cast<char*>(pIov->iov_base) + written;
+                pIov->iov_len -= written;
+            }
+        }
+    }
+#else
+    for (size_t i = 0; i < count; ++i) ofs.write(spans[i].data, spans[i].size);
+
+    if (!ofs.good())
+    {
+        errMsg = "write failed";
+        return 1;
+    }
+#endif
+
+    return 0;
+}
+
+//! @brief Copies the content of src to the file without reading it into user space
+//! @param src
+//! @param [out] errMsg
+//! @return 0 on success, 1 on error, 2 if not supported (nothing has been written)
+//!
+//! Has to be called on a newly opened file. The file is cloned (reflink) if the file system
+//! supports it, otherwise copy_file_range() is used. If the kernel refuses both, the caller has
+//! to write the data itself.
+//!
+int OutputFile::copyFrom(const std::filesystem::path& src, std::string& errMsg)
+{
+    TraceSpan span("copy file", "io");
+    if (span.active()) span.arg("src", src.string());
+
+#if PRJ_PLAT_UNIX && defined(__linux__)
+    if (!isOpen())
+    {
+        errMsg = "file not open";
+        return 1;
+    }
+
+    const int srcFd = ::open(src.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (srcFd < 0)
+    {
+        errMsg = "could not open file: " + string(strerror(errno));
+        return 1;
+    }
+
+    int r = 0;
+
+#ifdef FICLONE
+    if (ioctl(fd, FICLONE, srcFd) == 0)
+    {
+        ::close(srcFd);
+        return 0;
+    }
+#endif
+
+    while (1)
+    {
+        const ssize_t res = copy_file_range(srcFd, nullptr, fd, nullptr, 1024 * 1024 * 1024, 0);
+
+        if (res == 0) break; // end of file
+        else if ((res > 0) || (errno == EINTR)) continue;
+        else
+        {
+            if ((errno == ENOSYS) || (errno == EXDEV) || (errno == EINVAL) || (errno == EOPNOTSUPP) || (errno == EBADF))
+            {
+                // start over with a clean file
+                if ((ftruncate(fd, 0) == 0) && (lseek(fd, 0, SEEK_SET) == 0)) r = 2;
+                else
+                {
+                    errMsg = "could not reset file: " + string(strerror(errno));
+                    r = 1;
+                }
+            }
+            else
+            {
+                errMsg = "copy failed: " + string(strerror(errno));
+                r = 1;
+            }
+
+            break;
+        }
+    }
+
+    ::close(srcFd);
+
+    return r;
+#else
+    (void)src;
+    (void)errMsg;
+    return 2;
+#endif
+}
+
+bool OutputFile::isOpen() const
+{
+#if PRJ_PLAT_UNIX
+    return (fd >= 0);
+#else
+    return ofs.is_open();
+#endif
+}
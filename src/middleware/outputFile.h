@@ -0,0 +1,63 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#ifndef _OUTPUTFILE_H_
+#define _OUTPUTFILE_H_
+
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "project.h"
+
+//! @brief Piece of data to be written, refers to memory owned by someone else
+struct OutputSpan
+{
+    const char* data;
+    size_t size;
+};
+
+//! @brief Write only file
+//!
+//! Lists of spans are written with writev() in batches, so data scattered over several buffers
+//! needs neither to be copied together nor one system call per piece. Whole files can be copied
+//! inside of the kernel. A file opened by openReplace() is written next to its destination and
+//! replaces it when closed, so readers never see a partially written file.
+//!
+class OutputFile
+{
+public:
+    OutputFile();
+    OutputFile(const OutputFile& other) = delete;
+    OutputFile& operator=(const OutputFile& other) = delete;
+    ~OutputFile();
+
+    int open(const std::filesystem::path& filepath, std::string& errMsg);
+    int openReplace(const std::filesystem::path& filepath, std::string& errMsg);
+    int close(std::string& errMsg);
+    void discard();
+
+    int write(const char* data, size_t size, std::string& errMsg);
+    int write(const OutputSpan* spans, size_t count, std::string& errMsg);
+    int copyFrom(const std::filesystem::path& src, std::string& errMsg);
+
+    bool isOpen() const;
+
+private:
+    std::filesystem::path tmpPath; // not empty if opened by openReplace()
+    std::filesystem::path dstPath;
+
+#if PRJ_PLAT_UNIX
+    int fd;
+#else
+    std::ofstream ofs;
+#endif
+};
+
+#endif // _OUTPUTFILE_H_
@@ -0,0 +1,618 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#include "scanner.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SCANNER_X86 (1)
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#else
+#define SCANNER_X86 (0)
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SCANNER_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SCANNER_TARGET(isa)
+#endif
+
+namespace
+{
+    typedef const char* (*findPair_fn)(const char* p, const char* limit, char c0, char c1, size_t off);
+    typedef size_t(*countChar_fn)(const char* p, const char* end, char c);
+    typedef void (*countEndl_fn)(const char* p, const char* end, ScanEndlCount& cnt);
+    typedef char* (*convEndl_fn)(const char* p, const char* end, const char* inNL, size_t inNLSize, const char* outNL, size_t outNLSize, char* dst);
+
+    struct ScannerImpl
+    {
+        ScannerIsa isa;
+        findPair_fn findPair;
+        countChar_fn countChar;
+        countEndl_fn countEndl;
+        convEndl_fn convEndl;
+    };
+
+    inline bool isBlank(char c)
+    {
+        return ((c == 0x09) || (c == 0x20));
+    }
+
+    //! @brief Searches the first position i in [p, limit) where p[i] == c0 and p[i + off] == c1
+    //! @return Pointer to the position or limit if not found
+    //!
+    //! (limit - 1 + off) has to be a valid position.
+    //!
+    const char* findPair_scalar(const char* p, const char* limit, char c0, char c1, size_t off)
+    {
+        while (p < limit)
+        {
+            p = static_cast<const char*>(memchr(p, c0, limit - p));
+
+            if (!p) return limit;
+            if (*(p + off) == c1) return p;
+
+            ++p;
+        }
+
+        return limit;
+    }
+
+    size_t countChar_scalar(const char* p, const char* end, char c)
+    {
+        size_t cnt = 0;
+
+        while (p < end)
+        {
+            if (*p == c) ++cnt;
+            ++p;
+        }
+
+        return cnt;
+    }
+
+    void countEndl_scalar(const char* p, const char* end, ScanEndlCount& cnt)
+    {
+        while (p < end)
+        {
+            if (*p == 0x0A) ++cnt.lf;
+            else if (*p == 0x0D)
+            {
+                ++cnt.cr;
+                if (((p + 1) < end) && (*(p + 1) == 0x0A)) ++cnt.crlf;
+            }
+
+            ++p;
+        }
+    }
+
+    inline char* putNL(char* dst, const char* nl, size_t nlSize)
+    {
+        *dst = nl[0];
+        if (nlSize > 1) *(dst + 1) = nl[1];
+        return dst + nlSize;
+    }
+
+    char* convEndl_scalar(const char* p, const char* end, const char* inNL, size_t inNLSize, const char* outNL, size_t outNLSize, char* dst)
+    {
+        while (p < end)
+        {
+            const char* nl;
+
+            if (inNLSize > 1) nl = ((p < (end - 1)) ? findPair_scalar(p, end - 1, inNL[0], inNL[1], 1) : end);
+            else nl = static_cast<const char*>(memchr(p, inNL[0], end - p));
+
+            if (!nl || (nl >= end) || ((inNLSize > 1) && (nl == (end - 1))))
+            {
+                memcpy(dst, p, end - p);
+                return dst + (end - p);
+            }
+
+            memcpy(dst, p, nl - p);
+            dst = putNL(dst + (nl - p), outNL, outNLSize);
+            p = nl + inNLSize;
+        }
+
+        return dst;
+    }
+
+#if SCANNER_X86
+    inline unsigned int ctz32(uint32_t v)
+    {
+#ifdef _MSC_VER
+        unsigned long idx;
+        _BitScanForward(&idx, v);
+        return static_cast<unsigned int>(idx);
+#else
+        return static_cast<unsigned int>(__builtin_ctz(v));
+#endif
+    }
+
+    SCANNER_TARGET("sse2")
+    const char* findPair_sse2(const char* p, const char* limit, char c0, char c1, size_t off)
+    {
+        const __m128i v0 = _mm_set1_epi8(c0);
+        const __m128i v1 = _mm_set1_epi8(c1);
+
+        while ((limit - p) >= 16)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + off));
+            const uint32_t m = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, v0), _mm_cmpeq_epi8(b, v1))));
+
+            if (m) return p + ctz32(m);
+
+            p += 16;
+        }
+
+        return findPair_scalar(p, limit, c0, c1, off);
+    }
+
+    SCANNER_TARGET("sse2")
+    size_t countChar_sse2(const char* p, const char* end, char c)
+    {
+        const __m128i vc = _mm_set1_epi8(c);
+        const __m128i zero = _mm_setzero_si128();
+        size_t cnt = 0;
+
+        while ((end - p) >= 16)
+        {
+            // per lane byte counters, flushed before they can overflow
+            __m128i acc = _mm_setzero_si128();
+            int i = 0;
+
+            while ((i < 255) && ((end - p) >= 16))
+            {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(a, vc));
+                p += 16;
+                ++i;
+            }
+
+            const __m128i sum = _mm_sad_epu8(acc, zero);
+            cnt += static_cast<size_t>(_mm_cvtsi128_si32(sum)) + static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+        }
+
+        return cnt + countChar_scalar(p, end, c);
+    }
+
+    SCANNER_TARGET("sse2")
+    inline size_t sumBytes_sse2(__m128i acc)
+    {
+        const __m128i sum = _mm_sad_epu8(acc, _mm_setzero_si128());
+        return static_cast<size_t>(_mm_cvtsi128_si32(sum)) + static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+    }
+
+    SCANNER_TARGET("sse2")
+    void countEndl_sse2(const char* p, const char* end, ScanEndlCount& cnt)
+    {
+        const __m128i vLF = _mm_set1_epi8(0x0A);
+        const __m128i vCR = _mm_set1_epi8(0x0D);
+
+        // the pair compare reads one byte ahead
+        while ((end - p) > 16)
+        {
+            __m128i accLF = _mm_setzero_si128();
+            __m128i accCR = _mm_setzero_si128();
+            __m128i accCRLF = _mm_setzero_si128();
+            int i = 0;
+
+            while ((i < 255) && ((end - p) > 16))
+            {
+                const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+                const __m128i cr = _mm_cmpeq_epi8(a, vCR);
+
+                accLF = _mm_sub_epi8(accLF, _mm_cmpeq_epi8(a, vLF));
+                accCR = _mm_sub_epi8(accCR, cr);
+                accCRLF = _mm_sub_epi8(accCRLF, _mm_and_si128(cr, _mm_cmpeq_epi8(b, vLF)));
+                p += 16;
+                ++i;
+            }
+
+            cnt.lf += sumBytes_sse2(accLF);
+            cnt.cr += sumBytes_sse2(accCR);
+            cnt.crlf += sumBytes_sse2(accCRLF);
+        }
+
+        countEndl_scalar(p, end, cnt);
+    }
+
+    // Copies 16 bytes at once and continues after the first new line in them. The store may
+    // write up to 16 bytes behind the returned end, see scanConvertLineEndings().
+    SCANNER_TARGET("sse2")
+    char* convEndl_sse2(const char* p, const char* end, const char* inNL, size_t inNLSize, const char* outNL, size_t outNLSize, char* dst)
+    {
+        const __m128i v0 = _mm_set1_epi8(inNL[0]);
+        const __m128i v1 = _mm_set1_epi8(inNL[inNLSize - 1]);
+
+        while ((end - p) > 16)
+        {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i c = _mm_cmpeq_epi8(a, v0);
+            if (inNLSize > 1) c = _mm_and_si128(c, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1)), v1));
+
+            const uint32_t m = static_cast<uint32_t>(_mm_movemask_epi8(c));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), a);
+
+            if (m)
+            {
+                const unsigned int i = ctz32(m);
+                dst = putNL(dst + i, outNL, outNLSize);
+                p += i + inNLSize;
+            }
+            else
+            {
+                dst += 16;
+                p += 16;
+            }
+        }
+
+        return convEndl_scalar(p, end, inNL, inNLSize, outNL, outNLSize, dst);
+    }
+
+    SCANNER_TARGET("avx2")
+    const char* findPair_avx2(const char* p, const char* limit, char c0, char c1, size_t off)
+    {
+        const __m256i v0 = _mm256_set1_epi8(c0);
+        const __m256i v1 = _mm256_set1_epi8(c1);
+
+        while ((limit - p) >= 32)
+        {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + off));
+            const uint32_t m = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, v0), _mm256_cmpeq_epi8(b, v1))));
+
+            if (m) return p + ctz32(m);
+
+            p += 32;
+        }
+
+        return findPair_sse2(p, limit, c0, c1, off);
+    }
+
+    SCANNER_TARGET("avx2")
+    size_t countChar_avx2(const char* p, const char* end, char c)
+    {
+        const __m256i vc = _mm256_set1_epi8(c);
+        const __m256i zero = _mm256_setzero_si256();
+        size_t cnt = 0;
+
+        while ((end - p) >= 32)
+        {
+            __m256i acc = _mm256_setzero_si256();
+            int i = 0;
+
+            while ((i < 255) && ((end - p) >= 32))
+            {
+                const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(a, vc));
+                p += 32;
+                ++i;
+            }
+
+            const __m256i sum = _mm256_sad_epu8(acc, zero);
+            const __m128i sum128 = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+            cnt += static_cast<size_t>(_mm_cvtsi128_si32(sum128)) + static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(sum128, 8)));
+        }
+
+        return cnt + countChar_sse2(p, end, c);
+    }
+
+    SCANNER_TARGET("avx2")
+    inline size_t sumBytes_avx2(__m256i acc)
+    {
+        const __m256i sum = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+        const __m128i sum128 = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        return static_cast<size_t>(_mm_cvtsi128_si32(sum128)) + static_cast<size_t>(_mm_cvtsi128_si32(_mm_srli_si128(sum128, 8)));
+    }
+
+    SCANNER_TARGET("avx2")
+    void countEndl_avx2(const char* p, const char* end, ScanEndlCount& cnt)
+    {
+        const __m256i vLF = _mm256_set1_epi8(0x0A);
+        const __m256i vCR = _mm256_set1_epi8(0x0D);
+
+        while ((end - p) > 32)
+        {
+            __m256i accLF = _mm256_setzero_si256();
+            __m256i accCR = _mm256_setzero_si256();
+            __m256i accCRLF = _mm256_setzero_si256();
+            int i = 0;
+
+            while ((i < 255) && ((end - p) > 32))
+            {
+                const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+                const __m256i cr = _mm256_cmpeq_epi8(a, vCR);
+
+                accLF = _mm256_sub_epi8(accLF, _mm256_cmpeq_epi8(a, vLF));
+                accCR = _mm256_sub_epi8(accCR, cr);
+                accCRLF = _mm256_sub_epi8(accCRLF, _mm256_and_si256(cr, _mm256_cmpeq_epi8(b, vLF)));
+                p += 32;
+                ++i;
+            }
+
+            cnt.lf += sumBytes_avx2(accLF);
+            cnt.cr += sumBytes_avx2(accCR);
+            cnt.crlf += sumBytes_avx2(accCRLF);
+        }
+
+        countEndl_sse2(p, end, cnt);
+    }
+
+    SCANNER_TARGET("avx2")
+    char* convEndl_avx2(const char* p, const char* end, const char* inNL, size_t inNLSize, const char* outNL, size_t outNLSize, char* dst)
+    {
+        const __m256i v0 = _mm256_set1_epi8(inNL[0]);
+        const __m256i v1 = _mm256_set1_epi8(inNL[inNLSize - 1]);
+
+        while ((end - p) > 32)
+        {
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i c = _mm256_cmpeq_epi8(a, v0);
+            if (inNLSize > 1) c = _mm256_and_si256(c, _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1)), v1));
+
+            const uint32_t m = static_cast<uint32_t>(_mm256_movemask_epi8(c));
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), a);
+
+            if (m)
+            {
+                const unsigned int i = ctz32(m);
+                dst = putNL(dst + i, outNL, outNLSize);
+                p += i + inNLSize;
+            }
+            else
+            {
+                dst += 32;
+                p += 32;
+            }
+        }
+
+        return convEndl_sse2(p, end, inNL, inNLSize, outNL, outNLSize, dst);
+    }
+
+    bool cpuHasSse2()
+    {
+#if defined(__x86_64__) || defined(_M_X64)
+        return true;
+#elif defined(_MSC_VER)
+        int regs[4];
+        __cpuid(regs, 1);
+        return ((regs[3] & (1 << 26)) != 0);
+#else
+        return (__builtin_cpu_supports("sse2") != 0);
+#endif
+    }
+
+    bool cpuHasAvx2()
+    {
+#ifdef _MSC_VER
+        int regs[4];
+
+        __cpuid(regs, 0);
+        if (regs[0] < 7) return false;
+
+        __cpuid(regs, 1);
+        const bool osxsave = ((regs[2] & (1 << 27)) != 0);
+        const bool avx = ((regs[2] & (1 << 28)) != 0);
+        if (!osxsave || !avx) return false;
+        if ((_xgetbv(0) & 0x06) != 0x06) return false; // XMM and YMM state enabled by the OS
+
+        __cpuidex(regs, 7, 0);
+        return ((regs[1] & (1 << 5)) != 0);
+#else
+        return (__builtin_cpu_supports("avx2") != 0);
+#endif
+    }
+#endif // SCANNER_X86
+
+    ScannerImpl makeImpl(ScannerIsa isa)
+    {
+        ScannerImpl si;
+
+#if SCANNER_X86
+        if ((isa == ScannerIsa::avx2) && cpuHasAvx2())
+        {
+            si.isa = ScannerIsa::avx2;
+            si.findPair = findPair_avx2;
+            si.countChar = countChar_avx2;
+            si.countEndl = countEndl_avx2;
+            si.convEndl = convEndl_avx2;
+            return si;
+        }
+
+        if (((isa == ScannerIsa::avx2) || (isa == ScannerIsa::sse2)) && cpuHasSse2())
+        {
+            si.isa = ScannerIsa::sse2;
+            si.findPair = findPair_sse2;
+            si.countChar = countChar_sse2;
+            si.countEndl = countEndl_sse2;
+            si.convEndl = convEndl_sse2;
+            return si;
+        }
+#endif
+
+        si.isa = ScannerIsa::scalar;
+        si.findPair = findPair_scalar;
+        si.countChar = countChar_scalar;
+        si.countEndl = countEndl_scalar;
+        si.convEndl = convEndl_scalar;
+        return si;
+    }
+
+    ScannerImpl& impl()
+    {
+        static ScannerImpl instance = makeImpl(ScannerIsa::avx2);
+        return instance;
+    }
+}
+
+
+
+//! @brief Returns the instruction set used by the scan functions
+ScannerIsa scannerGetIsa()
+{
+    return impl().isa;
+}
+
+//! @brief Selects the instruction set used by the scan functions
+//! @param isa Requested instruction set, falls back to the best one supported by the CPU
+//! @return The selected instruction set
+//!
+//! The best supported instruction set is selected automatically, this is only needed to
+//! compare the implementations. Not thread safe, has to be called before any scanning.
+//!
+ScannerIsa scannerSetIsa(ScannerIsa isa)
+{
+    impl() = makeImpl(isa);
+    return impl().isa;
+}
+
+const char* scannerIsaName(ScannerIsa isa)
+{
+    if (isa == ScannerIsa::avx2) return "AVX2";
+    if (isa == ScannerIsa::sse2) return "SSE2";
+    return "scalar";
+}
+
+//! @brief Searches the next line whose first non blank characters are the tag
+//! @param p Start of a line
+//! @param end End of the buffer
+//! @param tag
+//! @param tagLen
+//! @return Pointer to the start of the found line or end if there is none
+//!
+//! Blanks are TAB and space, lines are terminated by LF. Lines in between are only touched by
+//! the vectorized candidate search, so files with few tags are scanned at about memchr speed.
+//!
+const char* scanFindTagLine(const char* p, const char* end, const char* tag, size_t tagLen)
+{
+    if ((tagLen == 0) || isBlank(tag[0]) || ((end - p) < static_cast<ptrdiff_t>(tagLen))) return end;
+
+    const ScannerImpl& si = impl();
+
+    // Candidates are searched by the first and the last non blank character of the tag, which
+    // is much more selective than the first character alone (think of "//" in C like files).
+    size_t off = tagLen - 1;
+    while ((off > 0) && isBlank(tag[off])) --off;
+
+    const char* const lineBegin = p;
+    const char* const limit = end - tagLen + 1;
+    const char* pos = p;
+
+    while (pos < limit)
+    {
+        const char* const cand = si.findPair(pos, limit, tag[0], tag[off], off);
+
+        if (cand >= limit) break;
+
+        if (memcmp(cand, tag, tagLen) == 0)
+        {
+            const char* ls = cand;
+            while ((ls > lineBegin) && isBlank(*(ls - 1))) --ls;
+
+            if ((ls == lineBegin) || (*(ls - 1) == 0x0A)) return ls;
+        }
+
+        pos = cand + 1;
+    }
+
+    return end;
+}
+
+//! @brief Searches the first occurrence of str
+//! @param p
+//! @param end
+//! @param str
+//! @param len
+//! @return Pointer to the found occurrence or end if there is none
+//!
+//! Candidates are searched by the first and the last character of str.
+//!
+const char* scanFindString(const char* p, const char* end, const char* str, size_t len)
+{
+    if ((len == 0) || ((end - p) < static_cast<ptrdiff_t>(len))) return end;
+
+    const ScannerImpl& si = impl();
+    const char* const limit = end - len + 1;
+
+    while (p < limit)
+    {
+        const char* const cand = si.findPair(p, limit, str[0], str[len - 1], len - 1);
+
+        if (cand >= limit) break;
+        if (memcmp(cand, str, len) == 0) return cand;
+
+        p = cand + 1;
+    }
+
+    return end;
+}
+
+//! @brief Searches the first position of c0 directly followed by c1
+//! @param p
+//! @param end
+//! @param c0
+//! @param c1
+//! @return Pointer to c0 or end if there is no such pair
+const char* scanFindPair(const char* p, const char* end, char c0, char c1)
+{
+    if ((end - p) < 2) return end;
+
+    const char* const limit = end - 1;
+    const char* const r = impl().findPair(p, limit, c0, c1, 1);
+
+    return ((r < limit) ? r : end);
+}
+
+//! @brief Counts the occurrences of c in [p, end)
+size_t scanCountChar(const char* p, const char* end, char c)
+{
+    return impl().countChar(p, end, c);
+}
+
+//! @brief Counts the line feeds, carriage returns and CR LF pairs in [p, end)
+//! @param p
+//! @param end
+//! @param [out] cnt
+//!
+//! A CR LF pair is counted in ScanEndlCount::cr and ScanEndlCount::lf too.
+//!
+void scanCountLineEndings(const char* p, const char* end, ScanEndlCount& cnt)
+{
+    cnt.lf = 0;
+    cnt.cr = 0;
+    cnt.crlf = 0;
+
+    impl().countEndl(p, end, cnt);
+}
+
+//! @brief Copies [p, end) to dst and replaces the new lines
+//! @param p
+//! @param end
+//! @param inNL New line to be replaced, 1 or 2 characters
+//! @param inNLSize
+//! @param outNL Replacement, 1 or 2 characters
+//! @param outNLSize
+//! @param dst Has to hold the converted data plus 32 bytes
+//! @return End of the converted data
+//!
+//! Up to 32 bytes behind the returned end may be overwritten.
+//!
+char* scanConvertLineEndings(const char* p, const char* end, const char* inNL, size_t inNLSize, const char* outNL, size_t outNLSize, char* dst)
+{
+    return impl().convEndl(p, end, inNL, inNLSize, outNL, outNLSize, dst);
+}
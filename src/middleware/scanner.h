@@ -0,0 +1,41 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#ifndef _SCANNER_H_
+#define _SCANNER_H_
+
+#include <cstddef>
+
+#include "project.h"
+
+enum class ScannerIsa
+{
+    scalar,
+    sse2,
+    avx2
+};
+
+struct ScanEndlCount
+{
+    size_t lf;
+    size_t cr;
+    size_t crlf;
+};
+
+ScannerIsa scannerGetIsa();
+ScannerIsa scannerSetIsa(ScannerIsa isa);
+const char* scannerIsaName(ScannerIsa isa);
+
+const char* scanFindTagLine(const char* p, const char* end, const char* tag, size_t tagLen);
+const char* scanFindString(const char* p, const char* end, const char* str, size_t len);
+const char* scanFindPair(const char* p, const char* end, char c0, char c1);
+size_t scanCountChar(const char* p, const char* end, char c);
+void scanCountLineEndings(const char* p, const char* end, ScanEndlCount& cnt);
+char* scanConvertLineEndings(const char* p, const char* end, const char* inNL, size_t inNLSize, const char* outNL, size_t outNLSize, char* dst);
+
+#endif // _SCANNER_H_
@@ -0,0 +1,207 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#include "trace.h"
+#include "util.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+using namespace std;
+
+namespace
+{
+    struct TraceEvent
+    {
+        string name;
+        const char* cat;
+        int64_t ts; // ns since traceStart()
+        int64_t dur;
+        int tid;
+        string args;
+    };
+
+    atomic<bool> traceOn(false);
+    chrono::steady_clock::time_point traceT0;
+
+    mutex traceMtx;
+    vector<TraceEvent> traceEvents;
+    map<int, string> traceThreadNames;
+
+    atomic<int> nextTid(1);
+
+    //! @brief Small numbers are easier to read in the viewer than the native IDs
+    int threadId()
+    {
+        thread_local const int tid = nextTid.fetch_add(1);
+        return tid;
+    }
+
+    int64_t now()
+    {
+        return static_cast<int64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - traceT0).count());
+    }
+
+    //! @brief The format uses microseconds
+    string usStr(int64_t ns)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%lld.%03lld", static_cast<long long>(ns / 1000), static_cast<long long>(ns % 1000));
+        return buffer;
+    }
+}
+
+
+
+TraceSpan::TraceSpan(const char* name, const char* cat)
+    : act(traceOn.load(memory_order_relaxed)), t0(0), cat(cat)
+{
+    if (act)
+    {
+        this->name = name;
+        t0 = now();
+    }
+}
+
+TraceSpan::~TraceSpan()
+{
+    end();
+}
+
+void TraceSpan::arg(const char* key, const std::string& value)
+{
+    if (!act) return;
+
+    if (!args.empty()) args += ',';
+    args += string("\"") + key + "\":\"" + jsonEscape(value) + "\"";
+}
+
+void TraceSpan::arg(const char* key, uint64_t value)
+{
+    if (!act) return;
+
+    if (!args.empty()) args += ',';
+    args += string("\"") + key + "\":" + to_string(value);
+}
+
+void TraceSpan::rename(const std::string& name)
+{
+    if (act) this->name = name;
+}
+
+void TraceSpan::end()
+{
+    if (!act) return;
+
+    act = false;
+
+    TraceEvent ev;
+    ev.name = move(name);
+    ev.cat = cat;
+    ev.ts = t0;
+    ev.dur = now() - t0;
+    ev.tid = threadId();
+    ev.args = move(args);
+
+    lock_guard<mutex> lock(traceMtx);
+    if (traceOn) traceEvents.push_back(move(ev));
+}
+
+bool TraceSpan::active() const
+{
+    return act;
+}
+
+//! @brief Clears the recorded events and starts recording, the calling thread is named "main"
+void traceStart()
+{
+    {
+        lock_guard<mutex> lock(traceMtx);
+        traceEvents.clear();
+        traceThreadNames.clear();
+        traceT0 = chrono::steady_clock::now();
+    }
+
+    traceOn = true;
+    traceThreadName("main");
+}
+
+bool traceActive()
+{
+    return traceOn.load(memory_order_relaxed);
+}
+
+//! @brief Names the calling thread in the viewer
+void traceThreadName(const std::string& name)
+{
+    if (!traceActive()) return;
+
+    const int tid = threadId();
+
+    lock_guard<mutex> lock(traceMtx);
+    traceThreadNames[tid] = name;
+}
+
+//! @brief Stops recording and writes the trace
+//! @param file
+//! @param [out] errMsg
+//! @return 0 on success
+//!
+//! The spans which are still open are not written.
+//!
+int traceWrite(const std::filesystem::path& file, std::string& errMsg)
+{
+    traceOn = false;
+
+    lock_guard<mutex> lock(traceMtx);
+
+    try
+    {
+        ofstream ofs;
+        ofs.exceptions(ios::failbit | ios::badbit);
+        ofs.open(file, ios::out | ios::binary | ios::trunc);
+
+        ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        ofs << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"potoroo\"}}";
+
+        for (auto it = traceThreadNames.begin(); it != traceThreadNames.end(); ++it)
+        {
+            ofs << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << it->first << ",\"args\":{\"name\":\"" << jsonEscape(it->second) << "\"}}";
+        }
+
+        for (size_t i = 0; i < traceEvents.size(); ++i)
+        {
+            const TraceEvent& ev = traceEvents[i];
+
+            ofs << ",\n{\"name\":\"" << jsonEscape(ev.name) << "\",\"cat\":\"" << ev.cat << "\",\"ph\":\"X\"";
+            ofs << ",\"ts\":" << usStr(ev.ts) << ",\"dur\":" << usStr(ev.dur) << ",\"pid\":1,\"tid\":" << ev.tid;
+            if (!ev.args.empty()) ofs << ",\"args\":{" << ev.args << "}";
+            ofs << "}";
+        }
+
+        ofs << "\n]}\n";
+    }
+    catch (const std::exception& ex)
+    {
+        errMsg = "could not write \"" + file.string() + "\": " + ex.what();
+        traceEvents.clear();
+        return 1;
+    }
+
+    traceEvents.clear();
+
+    return 0;
+}
@@ -0,0 +1,52 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Timeline in the Chrome trace event format, can be loaded by chrome://tracing and Perfetto.
+// Spans are only recorded between traceStart() and traceWrite(), otherwise they cost one
+// atomic load.
+
+//! @brief Records the lifetime of the object as complete event ("ph":"X") on the timeline
+class TraceSpan
+{
+public:
+    //! @param name Static string, is copied only if the trace is active
+    //! @param cat Category, static string
+    TraceSpan(const char* name, const char* cat);
+    TraceSpan(const TraceSpan& other) = delete;
+    TraceSpan& operator=(const TraceSpan& other) = delete;
+    ~TraceSpan();
+
+    //! @brief Arguments are shown by the viewer when the span is selected, only build expensive ones if active() is true
+    void arg(const char* key, const std::string& value);
+    void arg(const char* key, uint64_t value);
+    void rename(const std::string& name);
+    void end();
+
+    bool active() const;
+
+private:
+    bool act;
+    int64_t t0;
+    const char* cat;
+    std::string name;
+    std::string args;
+};
+
+void traceStart();
+bool traceActive();
+void traceThreadName(const std::string& name);
+int traceWrite(const std::filesystem::path& file, std::string& errMsg);
+
+#endif // _TRACE_H_
@@ -8,18 +8,126 @@
 
 #include "util.h"
 
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <string>
 #include <vector>
 
 #include "cliTextFormat.h"
+#include "inputFile.h"
+#include "scanner.h"
 
 namespace fs = std::filesystem;
 
 using namespace std;
 using namespace cli;
 
+namespace
+{
+    thread_local std::ostream* ewiOs = nullptr;
+    thread_local std::vector<EWIMessage>* ewiList = nullptr;
+    thread_local EwiFormat ewiFmt = EwiFormat::text;
+
+#if PRJ_PLAT_WIN
+    // sgr() sets the console attributes, so it has to be called in order
+#define EWI_SGR(...) sgr(__VA_ARGS__)
+#else
+    // the sequences don't change, each one is built once
+#define EWI_SGR(...) ([]() -> const string& { static const string s = sgr(__VA_ARGS__); return s; }())
+#endif
+
+    const char* ewiSeverity(int ewi)
+    {
+        if (ewi == 0) return "error";
+        if (ewi == 1) return "warning";
+        if (ewi == 2) return "info";
+        return "debug";
+    }
+
+    void printJson(ostream& os, const EWIMessage& msg)
+    {
+        os << "{\"type\":\"diagnostic\",\"severity\":\"" << ewiSeverity(msg.ewi) << "\",\"file\":\"" << jsonEscape(msg.file) << "\"";
+        if (msg.line > 0) os << ",\"line\":" << msg.line;
+        if (msg.col > 0) os << ",\"col\":" << msg.col;
+        if (msg.id != 0) os << ",\"id\":" << msg.id;
+        os << ",\"message\":\"" << jsonEscape(ewiPlainText(msg.text)) << "\"}\n";
+    }
+
+    //! @brief Messages of processes (style 0) have no location, the process name is part of the message
+    void printSarif(ostream& os, const EWIMessage& msg)
+    {
+        const char* const level = ((msg.ewi == 0) ? "error" : ((msg.ewi == 1) ? "warning" : "note"));
+        const bool location = ((msg.style == 1) && !msg.file.empty());
+        const string text = (location ? ewiPlainText(msg.text) : msg.file + ": " + ewiPlainText(msg.text));
+
+        os << "{";
+        if (msg.id != 0) os << "\"ruleId\":\"" << msg.id << "\",";
+        os << "\"level\":\"" << level << "\",\"message\":{\"text\":\"" << jsonEscape(text) << "\"}";
+
+        if (location)
+        {
+            os << ",\"locations\":[{\"physicalLocation\":{\"artifactLocation\":{\"uri\":\"" << jsonEscape(msg.file) << "\"}";
+
+            if (msg.line > 0)
+            {
+                os << ",\"region\":{\"startLine\":" << msg.line;
+                if (msg.col > 0) os << ",\"startColumn\":" << msg.col;
+                os << "}";
+            }
+
+            os << "}}]";
+        }
+
+        os << "}\n";
+    }
+
+    const size_t convBlockSize = 128 * 1024; // input bytes per block
+
+    bool isValidLineEnding(lineEnding le)
+    {
+        return ((le == lineEnding::LF) || (le == lineEnding::CR) || (le == lineEnding::CRLF));
+    }
+
+    const char* newLine(lineEnding le)
+    {
+        if (le == lineEnding::CR) return "\r";
+        if (le == lineEnding::CRLF) return "\r\n";
+        return "\n";
+    }
+
+    //! @brief Size of the destination buffer of convertEndl(), the worst case is LF to CRLF
+    size_t convBufferSize(size_t size)
+    {
+        return 2 * size + 32;
+    }
+
+    //! @brief Converts the line endings of [p, end) to dst
+    //! @return End of the written data
+    //!
+    //! The in and out line endings have to be valid and different, dst has to hold
+    //! convBufferSize(end - p) bytes.
+    //!
+    char* convertEndl(const char* p, const char* end, lineEnding inLE, lineEnding outLE, char* dst)
+    {
+        const char* const inNL = newLine(inLE);
+        const char* const outNL = newLine(outLE);
+
+        return scanConvertLineEndings(p, end, inNL, strlen(inNL), outNL, strlen(outNL), dst);
+    }
+
+    //! @brief Splits the data into blocks, a CR LF pair is never split
+    const char* nextBlockEnd(const char* p, const char* end)
+    {
+        if ((end - p) <= static_cast<ptrdiff_t>(convBlockSize)) return end;
+
+        const char* blockEnd = p + convBlockSize;
+        if ((*(blockEnd - 1) == 0x0D) && (*blockEnd == 0x0A)) ++blockEnd;
+
+        return blockEnd;
+    }
+}
+
 //! @brief Initializes Result::err and Result::warn to 0
 Result::Result()
     : err(0), warn(0)
@@ -81,33 +189,95 @@ std::ostream& operator<<(std::ostream& os, const Result& v)
     return os;
 }
 
-//! @brief Change working dir
-//! @param newWD 
-//! @return 0 on success, 1 on error
-Result changeWD(const std::filesystem::path& newWD, std::string* exWhat)
+//! @brief Stream the messages of printEWI() are written to
+//!
+//! Thread local, defaults to std::cout.
+//!
+std::ostream& ewiStream()
 {
-    int r = 1;
-    const string procStr = "change working dir";
-    string errMsg;
+    return (ewiOs ? *ewiOs : cout);
+}
 
-    try
-    {
-        fs::current_path(newWD);
-        r = 0;
-    }
-    catch (exception& ex)
-    {
-        errMsg = ex.what();
-    }
-    catch (...)
+//! @brief Redirects the messages of printEWI() printed by the calling thread
+//! @param os Stream to write to, nullptr to restore std::cout
+void setEwiStream(std::ostream* os)
+{
+    ewiOs = os;
+}
+
+//! @brief Messages of printEWI() printed by the calling thread are appended to the list instead of being printed
+//!
+//! Thread local, nullptr if the messages are printed.
+//!
+std::vector<EWIMessage>* ewiCapture()
+{
+    return ewiList;
+}
+
+//! @brief Captures the messages of printEWI() printed by the calling thread
+//! @param list List to append to, nullptr to print the messages again
+void setEwiCapture(std::vector<EWIMessage>* list)
+{
+    ewiList = list;
+}
+
+//! @brief Format of the messages printed by the calling thread
+//!
+//! Thread local, defaults to EwiFormat::text. Like the stream, it has to be passed on to
+//! worker threads.
+//!
+EwiFormat ewiFormat()
+{
+    return ewiFmt;
+}
+
+void setEwiFormat(EwiFormat format)
+{
+    ewiFmt = format;
+}
+
+//! @brief Wraps the results printed in the EwiFormat::sarif format into a SARIF 2.1.0 log
+//! @param results Output of printEWI(), one result object per line
+std::string ewiSarifLog(const std::string& results)
+{
+    string r = "{\"$schema\":\"https://json.schemastore.org/sarif-2.1.0.json\",\"version\":\"2.1.0\",\"runs\":[{";
+    r += "\"tool\":{\"driver\":{\"name\":\"potoroo\",\"version\":\"" + PRJ_VERSION.toString() + "\",\"informationUri\":\"https://github.com/oblaser/potoroo\"}},";
+    r += "\"results\":[";
+
+    size_t pos = 0;
+    bool first = true;
+
+    while (pos < results.length())
     {
-        errMsg = "unknown";
+        size_t end = results.find('\n', pos);
+        if (end == string::npos) end = results.length();
+
+        if (end > pos)
+        {
+            r += (first ? "\n" : ",\n");
+            r.append(results, pos, end - pos);
+            first = false;
+        }
+
+        pos = end + 1;
     }
 
-    if (r != 0)
+    r += "\n]}]}\n";
+
+    return r;
+}
+
+//! @brief Removes the formatting markup (leading "###" and '@') of a printEWI() text
+std::string ewiPlainText(const std::string& text)
+{
+    if ((text.length() <= 5) || (text.compare(0, 3, "###") != 0)) return text;
+
+    string r;
+    r.reserve(text.length());
+
+    for (size_t i = 3; i < text.length(); ++i)
     {
-        if (exWhat) *exWhat = std::string(errMsg);
-        else printEWI(procStr, errMsg, 0, 0, 0, 0);
+        if (text[i] != '@') r += text[i];
     }
 
     return r;
@@ -125,15 +295,44 @@ Result changeWD(const std::filesystem::path& newWD, std::string* exWhat)
 //! Styles: 0 process / 1 file
 void printEWI(const std::string& file, const std::string& text, size_t line, size_t col, int ewi, int style)
 {
+    printEWI(EWIMessage(file, text, line, col, ewi, style));
+}
+
+//! @brief Prints the message, or appends it to the list set by setEwiCapture()
+void printEWI(const EWIMessage& msg)
+{
+    if (ewiList)
+    {
+        ewiList->push_back(msg);
+        return;
+    }
+
+    if (ewiFmt != EwiFormat::text)
+    {
+        if (ewiFmt == EwiFormat::jsonLines) printJson(ewiStream(), msg);
+        else if (ewiFmt == EwiFormat::sarif) printSarif(ewiStream(), msg);
+
+        return;
+    }
+
+    const string& file = msg.file;
+    const string text = ((msg.id != 0) ? msg.text + " [" + to_string(msg.id) + "]" : msg.text);
+    const size_t line = msg.line;
+    const size_t col = msg.col;
+    const int ewi = msg.ewi;
+    const int style = msg.style;
+
+    ostream& os = ewiStream();
+
     // because of the sgr formatting we cant use iomanip
     size_t printedWidth = 0;
 
 
     printedWidth = file.length() + 1;
 
-    if (style == 0) cout << file << ":";
-    else if (style == 1) cout << sgr(SGRFGC_BRIGHT_WHITE) << file << sgr(SGR_RESET) << ":";
-    else cout << sgr(SGRFGC_BRIGHT_MAGENTA, SGR_BOLD) << "#printEWI style: " << style << "# " << sgr(SGR_RESET) << file << ":";
+    if (style == 0) os << file << ":";
+    else if (style == 1) os << EWI_SGR(SGRFGC_BRIGHT_WHITE) << file << EWI_SGR(SGR_RESET) << ":";
+    else os << EWI_SGR(SGRFGC_BRIGHT_MAGENTA, SGR_BOLD) << "#printEWI style: " << style << "# " << EWI_SGR(SGR_RESET) << file << ":";
 
 
     if (line > 0)
@@ -141,7 +340,7 @@ void printEWI(const std::string& file, const std::string& text, size_t line, siz
         const string lineStr = to_string(line);
         printedWidth += lineStr.length() + 1;
 
-        cout << sgr(SGRFGC_BRIGHT_WHITE) << lineStr << sgr(SGR_RESET) << ":";
+        os << EWI_SGR(SGRFGC_BRIGHT_WHITE) << lineStr << EWI_SGR(SGR_RESET) << ":";
     }
 
     if (col > 0)
@@ -149,33 +348,33 @@ void printEWI(const std::string& file, const std::string& text, size_t line, siz
         if (line <= 0)
         {
             ++printedWidth;
-            cout << ":";
+            os << ":";
         }
 
         const string colStr = to_string(col);
         printedWidth += colStr.length() + 1;
-        cout << sgr(SGRFGC_BRIGHT_WHITE) << colStr << sgr(SGR_RESET) << ":";
+        os << EWI_SGR(SGRFGC_BRIGHT_WHITE) << colStr << EWI_SGR(SGR_RESET) << ":";
     }
-    cout << " ";
+    os << " ";
 
-    while (printedWidth++ < 21) cout << " ";
+    while (printedWidth++ < 21) os << " ";
 
 
     const size_t ewiWidth = 9;
 
-    if (ewi == 0) cout << sgr(SGRFGC_BRIGHT_RED, SGR_BOLD) << left << setw(ewiWidth) << "error:";
-    else if (ewi == 1) cout << sgr(SGRFGC_BRIGHT_YELLOW, SGR_BOLD) << left << setw(ewiWidth) << "warning:";
-    else if (ewi == 2) cout << sgr(SGRFGC_BRIGHT_CYAN, SGR_BOLD) << left << setw(ewiWidth) << "info:";
+    if (ewi == 0) os << EWI_SGR(SGRFGC_BRIGHT_RED, SGR_BOLD) << left << setw(ewiWidth) << "error:";
+    else if (ewi == 1) os << EWI_SGR(SGRFGC_BRIGHT_YELLOW, SGR_BOLD) << left << setw(ewiWidth) << "warning:";
+    else if (ewi == 2) os << EWI_SGR(SGRFGC_BRIGHT_CYAN, SGR_BOLD) << left << setw(ewiWidth) << "info:";
 
 #if PRJ_DEBUG
-    else if (ewi == -1) cout << sgr(SGRFGC_BRIGHT_MAGENTA, SGR_BOLD) << left << setw(ewiWidth) << "debug:";
+    else if (ewi == -1) os << EWI_SGR(SGRFGC_BRIGHT_MAGENTA, SGR_BOLD) << left << setw(ewiWidth) << "debug:";
 #endif
 
-    else  cout << sgr(SGRFGC_BRIGHT_MAGENTA, SGR_BOLD) << "#printEWI ewi: " << ewi << "# " << sgr(SGRFGC_BRIGHT_RED, SGR_BOLD) << "error: ";
+    else  os << EWI_SGR(SGRFGC_BRIGHT_MAGENTA, SGR_BOLD) << "#printEWI ewi: " << ewi << "# " << EWI_SGR(SGRFGC_BRIGHT_RED, SGR_BOLD) << "error: ";
 
 
 
-    cout << sgr(SGR_RESET);
+    os << EWI_SGR(SGR_RESET);
 
     if (text.length() > 5)
     {
@@ -194,14 +393,14 @@ void printEWI(const std::string& file, const std::string& text, size_t line, siz
                 {
                     if (on)
                     {
-                        cout << sgr(SGR_RESET);
-                        cout << text[i];
+                        os << EWI_SGR(SGR_RESET);
+                        os << text[i];
                         on = false;
                     }
                     else
                     {
-                        cout << text[i];
-                        cout << sgr(SGRFGC_BRIGHT_WHITE);
+                        os << text[i];
+                        os << EWI_SGR(SGRFGC_BRIGHT_WHITE);
                         on = true;
                     }
                 }
@@ -209,97 +408,115 @@ void printEWI(const std::string& file, const std::string& text, size_t line, siz
                 {
                     if (on)
                     {
-                        cout << sgr(SGR_RESET);
+                        os << EWI_SGR(SGR_RESET);
                         on = false;
                     }
                     else
                     {
-                        cout << sgr(SGRFGC_BRIGHT_WHITE);
+                        os << EWI_SGR(SGRFGC_BRIGHT_WHITE);
                         on = true;
                     }
                 }
-                else cout << text[i];
+                else os << text[i];
 
                 ++i;
             }
 
-            cout << sgr(SGR_RESET) << endl;
+            os << EWI_SGR(SGR_RESET) << '\n';
             return;
         }
     }
 
-    cout << text << endl;
+    os << text << '\n';
 }
 
-lineEnding detectLineEnding(const std::filesystem::path& filepath)
+EWIMessage::EWIMessage()
+    : line(0), col(0), ewi(0x7FFFFFFF), style(0x7FFFFFFF), id(0)
+{
+}
+
+EWIMessage::EWIMessage(const std::string& file, const std::string& text, size_t line, size_t col, int ewi, int style, int id)
+    : file(file), text(text), line(line), col(col), ewi(ewi), style(style), id(id)
+{
+}
+
+LineEndingInfo::LineEndingInfo()
+    : le(lineEnding::error), nLF(0), nCR(0), nCRLF(0)
+{
+}
+
+//! @brief Checks if the file has more than one kind of line ending
+bool LineEndingInfo::mixed() const
 {
-    lineEnding le = lineEnding::error;
+    return (((nLF > 0) ? 1 : 0) + ((nCR > 0) ? 1 : 0) + ((nCRLF > 0) ? 1 : 0)) > 1;
+}
 
-    ifstream ifs;
+lineEnding detectLineEnding(const std::filesystem::path& filepath)
+{
+    LineEndingInfo info;
+    return detectLineEnding(filepath, info);
+}
 
-    ifs.open(filepath, ios::in | ios::binary);
+//! @brief Detects the line ending of a file
+//! @param filepath
+//! @param [out] info
+//! @return The line ending, lineEnding::error if the file could not be read
+lineEnding detectLineEnding(const std::filesystem::path& filepath, LineEndingInfo& info)
+{
+    InputFile ifile;
 
-    if (ifs.is_open())
+    if (ifile.open(filepath) != 0)
     {
-        char buffer[2] = { 0, 0 };
-        bool searching = true;
+        info = LineEndingInfo();
+        return lineEnding::error;
+    }
 
-        while (searching)
-        {
-            buffer[1] = static_cast<char>(ifs.get());
+    return detectLineEnding(ifile.data(), ifile.size(), info);
+}
 
-            if (ifs.good())
-            {
-                if ((buffer[0] != static_cast<char>(0x0D)) && (buffer[1] == static_cast<char>(0x0A)))
-                {
-                    searching = false;
-                    le = lineEnding::LF;
-                }
-                else if ((buffer[0] == static_cast<char>(0x0D)) && (buffer[1] != static_cast<char>(0x0A)))
-                {
-                    searching = false;
-                    le = lineEnding::CR;
-                }
-                else if ((buffer[0] == static_cast<char>(0x0D)) && (buffer[1] == static_cast<char>(0x0A)))
-                {
-                    searching = false;
-                    le = lineEnding::CRLF;
-                }
-                // else ; nop, still searching
-            }
-            else if (ifs.eof())
-            {
-                if (buffer[0] == static_cast<char>(0x0D))
-                {
-                    searching = false;
-                    le = lineEnding::CR;
-                }
-                else // no new line in file -> assume LF because its the simpliest
-                {
-                    searching = false;
-                    le = lineEnding::LF;
-                }
-            }
-            else
-            {
-                searching = false;
-                le = lineEnding::error;
-            }
+//! @brief Detects the line ending of a buffer
+//! @param data
+//! @param size
+//! @param [out] info
+//! @return The first line ending in the buffer, LF if there is none
+//!
+//! All line endings are counted in one vectorized pass, so files with mixed line endings can
+//! be reported.
+//!
+lineEnding detectLineEnding(const char* data, size_t size, LineEndingInfo& info)
+{
+    ScanEndlCount cnt;
+    scanCountLineEndings(data, data + size, cnt);
 
-            buffer[0] = buffer[1];
-        }
+    info.nCRLF = cnt.crlf;
+    info.nLF = cnt.lf - cnt.crlf;
+    info.nCR = cnt.cr - cnt.crlf;
 
-        ifs.close();
+    const char* const lf = static_cast<const char*>(memchr(data, 0x0A, size));
+    const char* const cr = (cnt.cr > 0 ? static_cast<const char*>(memchr(data, 0x0D, (lf ? lf - data : size))) : nullptr);
+
+    if (cr)
+    {
+        if (((cr + 1) < (data + size)) && (*(cr + 1) == 0x0A)) info.le = lineEnding::CRLF;
+        else info.le = lineEnding::CR;
     }
+    else info.le = lineEnding::LF; // also if there is no new line in the file, because LF is the simpliest
 
-    return le;
+    return info.le;
 }
 
+//! @brief Converts the line ending of a file
+//! @param inf
+//! @param outf
+//! @param outfLineEnding
+//! @return See convertLineEnding(const std::filesystem::path&, lineEnding, const std::filesystem::path&, lineEnding, std::string&)
+//!
+//! The line ending of the input file is detected on the same mapping which is converted.
+//!
 int convertLineEnding(const std::filesystem::path& inf, const std::filesystem::path& outf, lineEnding outfLineEnding)
 {
-    lineEnding ile = detectLineEnding(inf);
     string deadEnd;
-    return convertLineEnding(inf, ile, outf, outfLineEnding, deadEnd);
+    return convertLineEnding(inf, lineEnding::error, outf, outfLineEnding, deadEnd);
 }
 
 int convertLineEnding(const std::filesystem::path& inf, lineEnding infLineEnding, const std::filesystem::path& outf, lineEnding outfLineEnding)
@@ -308,117 +525,151 @@ int convertLineEnding(const std::filesystem::path& inf, lineEnding infLineEnding
     return convertLineEnding(inf, infLineEnding, outf, outfLineEnding, deadEnd);
 }
 
+//! @brief Converts the line ending of a file
+//! @param inf
+//! @param infLineEnding lineEnding::error to detect it
+//! @param outf
+//! @param outfLineEnding
+//! @param [out] errMsg
+//! @return 0 on success, 1 on invalid in line ending, 2 on invalid out line ending, 3 on IO error
+//!
+//! The input file is mapped and converted in large blocks, see convertLineEnding(const char*, size_t, lineEnding, std::vector<char>&, lineEnding).
+//!
 int convertLineEnding(const std::filesystem::path& inf, lineEnding infLineEnding, const std::filesystem::path& outf, lineEnding outfLineEnding, std::string& errMsg)
 {
-    int result = 0;
     errMsg.clear();
 
-    ifstream ifs;
-    ofstream ofs;
+    if (!isValidLineEnding(outfLineEnding))
+    {
+        errMsg = "invalid out line ending";
+        return 2;
+    }
 
-    ofs.exceptions(ios::failbit | ios::badbit | ios::eofbit);
+    InputFile ifile;
 
-    ifs.open(inf, ios::in | ios::binary);
-    ofs.open(outf, ios::out | ios::binary);
+    if (ifile.open(inf, errMsg) != 0)
+    {
+        errMsg = "in file IO error: " + errMsg;
+        return 3;
+    }
 
-    bool proc = true;
+    if (infLineEnding == lineEnding::error)
+    {
+        LineEndingInfo info;
+        infLineEnding = detectLineEnding(ifile.data(), ifile.size(), info);
+    }
 
-    if (infLineEnding == lineEnding::CRLF)
+    if (!isValidLineEnding(infLineEnding))
     {
-        char c[2] = { 0, 0 };
+        errMsg = "invalid in line ending";
+        return 1;
+    }
 
-        while (proc)
-        {
-            c[0] = static_cast<char>(ifs.get());
+    try
+    {
+        ofstream ofs;
+        ofs.exceptions(ios::failbit | ios::badbit | ios::eofbit);
+        ofs.open(outf, ios::out | ios::binary);
 
-            if (ifs.good())
-            {
-                if (c[0] == static_cast<char>(0x0D))
-                {
-                    c[1] = static_cast<char>(ifs.get());
+        const char* p = ifile.data();
+        const char* const end = p + ifile.size();
 
-                    if (ifs.good())
-                    {
-                        if ((c[0] == static_cast<char>(0x0D)) && (c[1] == static_cast<char>(0x0A)))
-                        {
-                            if (outfLineEnding == lineEnding::LF) ofs.put(0x0A);
-                            else if (outfLineEnding == lineEnding::CR) ofs.put(0x0D);
-                            else if (outfLineEnding == lineEnding::CRLF) { ofs.put(0x0D); ofs.put(0x0A); }
-                            else
-                            {
-                                errMsg = "invalid out line ending";
-                                result = 2;
-                                proc = false;
-                            }
-                        }
-                        else
-                        {
-                            ofs.put(c[0]);
-                            ofs.put(c[1]);
-                        }
-                    }
-                    else if (ifs.eof())
-                    {
-                        ofs.put(c[0]);
-                        proc = false;
-                    }
-                    else
-                    {
-                        errMsg = "in file IO error: ";
+        if (infLineEnding == outfLineEnding) ofs.write(p, end - p);
+        else
+        {
+            vector<char> buffer(convBufferSize(convBlockSize + 1));
 
-                        if (ifs.bad()) errMsg += "badbit";
-                        else if (ifs.fail()) errMsg += "failbit";
-                        else errMsg += "unknown";
+            while (p < end)
+            {
+                const char* const blockEnd = nextBlockEnd(p, end);
+                char* const bufferEnd = convertEndl(p, blockEnd, infLineEnding, outfLineEnding, buffer.data());
 
-                        result = 3;
-                        proc = false;
-                    }
-                }
-                else ofs.put(c[0]);
+                ofs.write(buffer.data(), bufferEnd - buffer.data());
+                p = blockEnd;
             }
-            else proc = false;
         }
+
+        ofs.close();
     }
-    else if ((infLineEnding == lineEnding::LF) || (infLineEnding == lineEnding::CR))
+    catch (...)
     {
-        while (proc)
+        errMsg = "out file IO error";
+        return 3;
+    }
+
+    return 0;
+}
+
+//! @brief Converts the line ending of a buffer
+//! @param data
+//! @param size
+//! @param inLineEnding
+//! @param [out] out Converted data, previous content is replaced
+//! @param outLineEnding
+//! @return 0 on success, 1 on invalid in line ending, 2 on invalid out line ending
+//!
+//! A CR which is not followed by a LF is kept in CRLF data.
+//!
+int convertLineEnding(const char* data, size_t size, lineEnding inLineEnding, std::vector<char>& out, lineEnding outLineEnding)
+{
+    out.clear();
+
+    if (!isValidLineEnding(inLineEnding)) return 1;
+    if (!isValidLineEnding(outLineEnding)) return 2;
+
+    if (inLineEnding == outLineEnding) out.assign(data, data + size);
+    else
+    {
+        const char* p = data;
+        const char* const end = data + size;
+        vector<char> buffer(convBufferSize(convBlockSize + 1));
+
+        out.reserve(size + ((outLineEnding == lineEnding::CRLF) ? (size / 16) : 0));
+
+        while (p < end)
         {
-            char c = static_cast<char>(ifs.get());
+            const char* const blockEnd = nextBlockEnd(p, end);
+            char* const bufferEnd = convertEndl(p, blockEnd, inLineEnding, outLineEnding, buffer.data());
 
-            if (ifs.good())
-            {
-                if (((infLineEnding == lineEnding::LF) && (c == static_cast<char>(0x0A))) ||
-                    ((infLineEnding == lineEnding::CR) && (c == static_cast<char>(0x0D)))
-                    )
-                {
-                    if (outfLineEnding == lineEnding::LF) ofs.put(0x0A);
-                    else if (outfLineEnding == lineEnding::CR) ofs.put(0x0D);
-                    else if (outfLineEnding == lineEnding::CRLF) { ofs.put(0x0D); ofs.put(0x0A); }
-                    else
-                    {
-                        errMsg = "invalid out line ending";
-                        result = 2;
-                        proc = false;
-                    }
-                }
-                else ofs.put(c);
-            }
-            else proc = false;
+            out.insert(out.end(), buffer.data(), bufferEnd);
+            p = blockEnd;
         }
     }
-    else
+
+    return 0;
+}
+
+//! @brief 64bit hash of the data, to detect changed file contents (not cryptographic)
+//!
+//! FNV-1a on 8 byte words, the remaining bytes are hashed one by one.
+//!
+uint64_t contentHash(const char* data, size_t size)
+{
+    const uint64_t prime = 0x00000100000001B3ull;
+    uint64_t h = 0xCBF29CE484222325ull ^ size;
+
+    const char* p = data;
+    const char* const end = data + size;
+
+    while ((end - p) >= 8)
     {
-        errMsg = "invalid in line ending";
-        result = 1;
-    }
+        uint64_t w;
+        memcpy(&w, p, 8);
 
-    ifs.close();
-    ofs.close();
+        h = (h ^ w) * prime;
+        h ^= (h >> 29);
 
-    return result;
-}
+        p += 8;
+    }
 
+    while (p < end)
+    {
+        h = (h ^ static_cast<uint8_t>(*p)) * prime;
+        ++p;
+    }
 
+    return h;
+}
 
 size_t strReplaceAll(std::string& str, const std::string& from, const std::string& to)
 {
@@ -443,6 +694,34 @@ size_t strReplaceAll(std::string& str, const std::string& from, const std::strin
     return cnt;
 }
 
+//! @brief Escapes the string to be used as JSON string, without the quotes
+std::string jsonEscape(const std::string& str)
+{
+    std::string r;
+    r.reserve(str.length());
+
+    for (size_t i = 0; i < str.length(); ++i)
+    {
+        const char c = str[i];
+
+        if (c == '"') r += "\\\"";
+        else if (c == '\\') r += "\\\\";
+        else if (c == '\n') r += "\\n";
+        else if (c == '\r') r += "\\r";
+        else if (c == '\t') r += "\\t";
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            static const char hex[] = "0123456789abcdef";
+            r += "\\u00";
+            r += hex[(c >> 4) & 0x0F];
+            r += hex[c & 0x0F];
+        }
+        else r += c;
+    }
+
+    return r;
+}
+
 bool vectorContains(const std::vector<int>& vec, int value)
 {
     for (size_t i = 0; i < vec.size(); ++i)
@@ -9,6 +9,7 @@
 #ifndef _UTIL_H_
 #define _UTIL_H_
 
+#include <cstdint>
 #include <filesystem>
 #include <iostream>
 #include <string>
@@ -64,18 +65,72 @@ enum class lineEnding
     CRLF
 };
 
+//! @brief Line endings found in a file
+struct LineEndingInfo
+{
+    LineEndingInfo();
+
+    lineEnding le; // first line ending of the file, LF if there is none
+    size_t nLF;
+    size_t nCR;
+    size_t nCRLF;
+
+    bool mixed() const;
+};
+
+
+
+//! @brief Message of printEWI()
+struct EWIMessage
+{
+    EWIMessage();
+    EWIMessage(const std::string& file, const std::string& text, size_t line, size_t col, int ewi, int style, int id = 0);
+
+    std::string file;
+    std::string text;
+    size_t line;
+    size_t col;
+    int ewi;
+    int style;
+    int id; // warning ID, appended to the text, 0 if none
+};
+
+
+
+//! @brief Output format of printEWI()
+enum class EwiFormat
+{
+    text,
+    jsonLines, // one JSON object per message
+    sarif, // one SARIF result object per line, wrapped by ewiSarifLog()
+    quiet // nothing is printed
+};
 
 
-Result changeWD(const std::filesystem::path& newWD, std::string* exWhat = nullptr);
 
 void printEWI(const std::string& file, const std::string& text, size_t line = 0, size_t col = 0, int ewi = 0x7FFFFFFF, int style = 0x7FFFFFFF);
+void printEWI(const EWIMessage& msg);
+std::ostream& ewiStream();
+void setEwiStream(std::ostream* os);
+std::vector<EWIMessage>* ewiCapture();
+void setEwiCapture(std::vector<EWIMessage>* list);
+std::string ewiPlainText(const std::string& text);
+EwiFormat ewiFormat();
+void setEwiFormat(EwiFormat format);
+std::string ewiSarifLog(const std::string& results);
 
 lineEnding detectLineEnding(const std::filesystem::path& filepath);
+lineEnding detectLineEnding(const std::filesystem::path& filepath, LineEndingInfo& info);
+lineEnding detectLineEnding(const char* data, size_t size, LineEndingInfo& info);
 int convertLineEnding(const std::filesystem::path& inf, const std::filesystem::path& outf, lineEnding outfLineEnding);
 int convertLineEnding(const std::filesystem::path& inf, lineEnding infLineEnding, const std::filesystem::path& outf, lineEnding outfLineEnding);
 int convertLineEnding(const std::filesystem::path& inf, lineEnding infLineEnding, const std::filesystem::path& outf, lineEnding outfLineEnding, std::string& errMsg);
+int convertLineEnding(const char* data, size_t size, lineEnding inLineEnding, std::vector<char>& out, lineEnding outLineEnding);
+
+uint64_t contentHash(const char* data, size_t size);
 
 size_t strReplaceAll(std::string& str, const std::string& from, const std::string& to);
+std::string jsonEscape(const std::string& str);
 
 bool vectorContains(const std::vector<int>& vec, int value);
 
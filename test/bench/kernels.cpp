@@ -0,0 +1,559 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+// Throughput and allocations of the processing kernels. The inputs are generated with fixed
+// seeds, so the numbers of different commits can be compared. Each case is run once to warm
+// up, the best of N runs is reported. Allocations are counted by the replaced global operator
+// new during the last run.
+//
+// The "proc/directive allocs" case fails if the processor allocates memory per directive, the
+// "jobfile 100k lines" case if parsing a jobfile of 100'000 lines takes 100 ms or more, or if it
+// allocates memory for the common lines (only -Wsup lists are allowed to).
+//
+// usage: bench_kernels [SIZE_MIB [FILTER]]
+//   SIZE_MIB  size of the generated inputs (default 16)
+//   FILTER    only runs the cases whose name contains FILTER
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "libpotoroo.h"
+#include "application/arg.h"
+#include "application/job.h"
+#include "middleware/scanner.h"
+#include "middleware/util.h"
+
+namespace fs = std::filesystem;
+
+using namespace std;
+using namespace potoroo;
+
+namespace
+{
+    atomic<size_t> nAllocs(0);
+}
+
+void* operator new(size_t size)
+{
+    ++nAllocs;
+
+    void* p = malloc(size ? size : 1);
+    if (!p) throw bad_alloc();
+
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace
+{
+    const char* leStr(lineEnding le)
+    {
+        if (le == lineEnding::CR) return "CR";
+        if (le == lineEnding::CRLF) return "CRLF";
+        return "LF";
+    }
+
+    const char* leNL(lineEnding le)
+    {
+        if (le == lineEnding::CR) return "\r";
+        if (le == lineEnding::CRLF) return "\r\n";
+        return "\n";
+    }
+
+    //! @brief Source code like line, length 0..120, never contains a tag
+    void codeLine(string& data, mt19937& rng, const char* nl)
+    {
+        static const string chars = "abcdefghijklmnopqrstuvwxyz    ;(){}=+-*/\t";
+
+        const size_t len = rng() % 121;
+        for (size_t i = 0; i < len; ++i) data += chars[rng() % chars.length()];
+        data += nl;
+    }
+
+    string genPlain(size_t size, lineEnding le)
+    {
+        mt19937 rng(42);
+        string data;
+        data.reserve(size + 128);
+
+        while (data.size() < size) codeLine(data, rng, leNL(le));
+
+        return data;
+    }
+
+    //! @brief Puts a "\r\r\n" at every block boundary of convertLineEnding(), the last CR of a block is not part of a CR LF pair
+    void addBoundaryCRs(string& data)
+    {
+        const size_t blockSize = 128 * 1024;
+        for (size_t i = blockSize - 1; (i + 3) <= data.size(); i += blockSize) data.replace(i, 3, "\r\r\n");
+    }
+
+    string convertPlain(const string& data, lineEnding inLE, lineEnding outLE)
+    {
+        const string inNL = leNL(inLE);
+        const string outNL = leNL(outLE);
+
+        string r;
+        r.reserve(2 * data.size());
+
+        size_t i = 0;
+        while (i < data.size())
+        {
+            if (data.compare(i, inNL.length(), inNL) == 0)
+            {
+                r += outNL;
+                i += inNL.length();
+            }
+            else r += data[i++];
+        }
+
+        return r;
+    }
+
+    //! @brief Every second line is a directive
+    string genDense(size_t size)
+    {
+        mt19937 rng(43);
+        string data;
+        data.reserve(size + 256);
+
+        while (data.size() < size)
+        {
+            codeLine(data, rng, "\n");
+
+            switch (rng() % 5)
+            {
+            case 0:
+                data += "    //#p ins const x = 1;\n";
+                break;
+
+            case 1:
+                data += "//#p rmn 1\n";
+                codeLine(data, rng, "\n");
+                break;
+
+            case 2:
+                data += "//#p rm\n";
+                codeLine(data, rng, "\n");
+                data += "//#p endrm\n";
+                break;
+
+            case 3:
+                data += "//#p include \"inc.js\"\n";
+                break;
+
+            default:
+                data += "//#p include 'raw.txt'\n";
+                break;
+            }
+        }
+
+        return data;
+    }
+
+    //! @brief Most of the input is inside of long rm blocks
+    string genDeepRm(size_t size)
+    {
+        mt19937 rng(44);
+        string data;
+        data.reserve(size + 256);
+
+        while (data.size() < size)
+        {
+            codeLine(data, rng, "\n");
+            data += "//#p rm\n";
+            for (size_t i = 0; i < 1000; ++i) codeLine(data, rng, "\n");
+            data += "//#p endrm\n";
+        }
+
+        return data;
+    }
+
+    //! @brief n groups of rm, endrm, rmn and ins directives, no includes
+    string genDirectives(size_t n)
+    {
+        mt19937 rng(47);
+        string data;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            codeLine(data, rng, "\n");
+            data += "//#p rm\n";
+            codeLine(data, rng, "\n");
+            data += "//#p endrm\n";
+            data += "//#p rmn 1\n";
+            codeLine(data, rng, "\n");
+            data += "    //#p ins const x = 1;\n";
+        }
+
+        return data;
+    }
+
+    void jobfileLine(string& data, unsigned kind, const string& name)
+    {
+        switch (kind)
+        {
+        case 0:
+            data += "-if ./src/" + name + ".js -od ./deploy/js\n";
+            break;
+
+        case 1:
+            data += "-if \"./src/a dir/" + name + ".css\" -of \"./deploy/css/" + name + ".min.css\" -t cpp -Werror\n";
+            break;
+
+        case 2:
+            data += "-if ./assets/" + name + ".png -od ./deploy/img --copy\n";
+            break;
+
+        case 3:
+            data += "-if ./scripts/" + name + ".sh -od ./deploy/bin -t bash -Wsup 103,104 --write-if-changed\n";
+            break;
+
+        default:
+            data += "    -if \"./a dir/" + name + ".ext\"  \t  -od ../../000\t-Werror -t custom:\"*p\n";
+            break;
+        }
+    }
+
+    string genJobfile(size_t size)
+    {
+        mt19937 rng(45);
+        string data;
+        data.reserve(size + 256);
+
+        for (size_t i = 0; data.size() < size; ++i)
+        {
+            if ((i % 50) == 0) data += "# section " + to_string(i / 50) + "\n";
+
+            const string name = "file" + to_string(rng() % 100000);
+            jobfileLine(data, rng() % 4, name);
+        }
+
+        return data;
+    }
+
+    //! @brief n lines like the ones of stressTest_jobfileParser.potorooJobs, with comments and empty lines
+    string genJobfileLines(size_t n)
+    {
+        mt19937 rng(48);
+        string data;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            if ((i % 50) == 0) data += "# section " + to_string(i / 50) + "\n";
+            else if ((i % 50) == 25) data += "\n";
+            else
+            {
+                const string name = "file" + to_string(rng() % 100000);
+                jobfileLine(data, rng() % 5, name);
+            }
+        }
+
+        return data;
+    }
+
+    vector<string> genArgStrings(size_t size, size_t& nBytes)
+    {
+        mt19937 rng(46);
+        vector<string> v;
+        nBytes = 0;
+
+        while (nBytes < size)
+        {
+            const string name = "file" + to_string(rng() % 100000);
+            string s = "-if \"./src/a dir/" + name + ".js\" -of ./deploy/" + name + ".js -t custom:\"//#x\" -Werror -Wsup 103,104";
+
+            if (rng() % 2) s += " --write-error-line \"// error\"";
+
+            nBytes += s.length();
+            v.push_back(s);
+        }
+
+        return v;
+    }
+
+    struct Measurement
+    {
+        double mbps;
+        double allocsPerMB;
+    };
+
+    template <class F>
+    Measurement measure(F f, size_t nBytes, int nRuns)
+    {
+        f();
+
+        Measurement m;
+        m.mbps = 0;
+        m.allocsPerMB = 0;
+
+        for (int i = 0; i < nRuns; ++i)
+        {
+            const size_t a0 = nAllocs;
+            const auto t0 = chrono::steady_clock::now();
+            f();
+            const auto t1 = chrono::steady_clock::now();
+            const size_t a1 = nAllocs;
+
+            const double s = chrono::duration<double>(t1 - t0).count();
+            const double mbps = ((s > 0) ? (static_cast<double>(nBytes) / s / 1e6) : 0);
+            if (mbps > m.mbps) m.mbps = mbps;
+
+            m.allocsPerMB = static_cast<double>(a1 - a0) / (static_cast<double>(nBytes) / 1e6);
+        }
+
+        return m;
+    }
+
+    class Bench
+    {
+    public:
+        Bench(const string& filter) : filter(filter), nFailed(0) {}
+
+        bool enabled(const string& name) const
+        {
+            return (filter.empty() || (name.find(filter) != string::npos));
+        }
+
+        template <class F>
+        void run(const string& name, size_t nBytes, int nRuns, F f)
+        {
+            if (!enabled(name)) return;
+
+            const Measurement m = measure(f, nBytes, nRuns);
+
+            cout << left << setw(28) << name << right << fixed << setprecision(1)
+                << setw(10) << (static_cast<double>(nBytes) / 1e6)
+                << setw(12) << setprecision(0) << m.mbps
+                << setw(14) << setprecision(2) << m.allocsPerMB << endl;
+        }
+
+        void fail(const string& name, const string& msg)
+        {
+            cout << name << ": " << msg << endl;
+            ++nFailed;
+        }
+
+        int failed() const
+        {
+            return nFailed;
+        }
+
+    private:
+        string filter;
+        int nFailed;
+    };
+
+    void benchProc(Bench& b, const string& name, const string& input)
+    {
+        if (!b.enabled(name)) return;
+
+        BufferOptions opt;
+        opt.wSup.push_back(104); // the dense input includes the same file many times
+
+        const IncludeResolver resolver = [](const string& path, string& content)
+        {
+            if (fs::path(path).filename() == "inc.js") content = "const inc = 1;\n//#p ins const nested = 2;\n";
+            else if (fs::path(path).filename() == "raw.txt") content = "raw //#p text\n";
+            else return false;
+
+            return true;
+        };
+
+        size_t nOut = 0;
+        const OutputSink sink = [&nOut](const char*, size_t size) { nOut += size; };
+
+        const BufferResult r = processBuffer(input, "bench/input.js", opt, resolver, sink);
+        if ((r.err != 0) || (nOut == 0)) b.fail(name, to_string(r.err) + " errors, " + to_string(nOut) + " bytes output");
+
+        b.run(name, input.size(), 5, [&]() { processBuffer(input, "bench/input.js", opt, resolver, sink); });
+    }
+
+    //! @brief Processes n and 2n directives, the difference of the allocations may only come from growing buffers
+    void checkDirectiveAllocs(Bench& b)
+    {
+        const string name = "proc/directive allocs";
+        if (!b.enabled(name)) return;
+
+        const size_t nGroups = 50000;
+        const size_t nDirectivesPerGroup = 4;
+
+        const BufferOptions opt;
+        const IncludeResolver resolver = [](const string&, string&) { return false; };
+        const OutputSink sink = [](const char*, size_t) {};
+
+        size_t allocs[2];
+
+        for (size_t i = 0; i < 2; ++i)
+        {
+            const string input = genDirectives(nGroups * (i + 1));
+
+            const size_t a0 = nAllocs;
+            const BufferResult r = processBuffer(input, "bench/input.js", opt, resolver, sink);
+            allocs[i] = nAllocs - a0;
+
+            if ((r.err != 0) || (r.warn != 0)) b.fail(name, to_string(r.err) + " errors, " + to_string(r.warn) + " warnings");
+        }
+
+        const double perDirective = static_cast<double>(allocs[1] - allocs[0]) / static_cast<double>(nGroups * nDirectivesPerGroup);
+
+        cout << left << setw(28) << name << right << fixed << setprecision(4) << perDirective << " allocs/directive (" << allocs[0] << ", " << allocs[1] << ")" << endl;
+
+        if (perDirective > 0.001) b.fail(name, "allocates per directive");
+    }
+}
+
+
+
+int main(int argc, char** argv)
+{
+    size_t sizeMiB = 16;
+    string filter;
+
+    if (argc > 1) sizeMiB = stoul(argv[1]);
+    if (argc > 2) filter = argv[2];
+
+    const size_t size = sizeMiB * 1024 * 1024;
+
+    Bench b(filter);
+
+    cout << "kernels, " << sizeMiB << " MiB inputs, scanner " << scannerIsaName(scannerGetIsa()) << endl;
+    cout << left << setw(28) << "case" << right << setw(10) << "MB" << setw(12) << "MB/s" << setw(14) << "allocs/MB" << endl;
+
+    // processor
+    benchProc(b, "proc/plain", genPlain(size, lineEnding::LF));
+    benchProc(b, "proc/plain CRLF", genPlain(size, lineEnding::CRLF));
+    benchProc(b, "proc/dense", genDense(size));
+    benchProc(b, "proc/deep-rm", genDeepRm(size));
+    checkDirectiveAllocs(b);
+
+    // line endings
+    const lineEnding les[] = { lineEnding::LF, lineEnding::CR, lineEnding::CRLF };
+
+    for (const lineEnding le : les)
+    {
+        const string name = string("detectLineEnding/") + leStr(le);
+        if (!b.enabled(name)) continue;
+
+        const string data = genPlain(size, le);
+        LineEndingInfo info;
+
+        if (detectLineEnding(data.data(), data.size(), info) != le) b.fail(name, "wrong line ending detected");
+
+        b.run(name, data.size(), 5, [&]() { detectLineEnding(data.data(), data.size(), info); });
+    }
+
+    for (const lineEnding inLE : les)
+    {
+        for (const lineEnding outLE : les)
+        {
+            const string name = string("convertLineEnding/") + leStr(inLE) + "-" + leStr(outLE);
+            if (!b.enabled(name)) continue;
+
+            string data = genPlain(size, inLE);
+            addBoundaryCRs(data);
+            vector<char> out;
+
+            if (convertLineEnding(data.data(), data.size(), inLE, out, outLE) != 0) b.fail(name, "conversion failed");
+            else if (string(out.data(), out.size()) != convertPlain(data, inLE, outLE)) b.fail(name, "wrong output");
+
+            b.run(name, data.size(), 5, [&]() { convertLineEnding(data.data(), data.size(), inLE, out, outLE); });
+        }
+    }
+
+    // jobfile
+    if (b.enabled("Job::parseFile"))
+    {
+        const fs::path dir = fs::temp_directory_path() / "potoroo_bench_kernels";
+        fs::create_directories(dir);
+
+        const fs::path jobfile = dir / "potorooJobs";
+        const string data = genJobfile(size / 4);
+        ofstream(jobfile, ios::out | ios::binary).write(data.data(), data.size());
+
+        vector<Job> jobs;
+        const Result r = Job::parseFile(jobfile.string(), jobs);
+        if ((r.err != 0) || jobs.empty()) b.fail("Job::parseFile", to_string(r.err) + " errors, " + to_string(jobs.size()) + " jobs");
+
+        b.run("Job::parseFile", data.size(), 3, [&]() { jobs.clear(); Job::parseFile(jobfile.string(), jobs); });
+
+        fs::remove_all(dir);
+    }
+
+    // the generated jobfiles of the projects using potoroo
+    if (b.enabled("jobfile 100k lines"))
+    {
+        const string name = "jobfile 100k lines";
+        const fs::path dir = fs::temp_directory_path() / "potoroo_bench_kernels";
+        fs::create_directories(dir);
+
+        const size_t nLines = 100000;
+        const fs::path jobfile = dir / "potorooJobs";
+        const string data = genJobfileLines(nLines);
+        ofstream(jobfile, ios::out | ios::binary).write(data.data(), data.size());
+
+        vector<Job> jobs;
+        const Result r = Job::parseFile(jobfile.string(), jobs);
+        if ((r.err != 0) || (jobs.size() != (nLines - (nLines / 25)))) b.fail(name, to_string(r.err) + " errors, " + to_string(jobs.size()) + " jobs");
+
+        double best = 0;
+        size_t allocs = 0;
+
+        for (int i = 0; i < 5; ++i)
+        {
+            jobs.clear();
+
+            const size_t a0 = nAllocs;
+            const auto t0 = chrono::steady_clock::now();
+            Job::parseFile(jobfile.string(), jobs);
+            const double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+            allocs = nAllocs - a0;
+
+            if ((i == 0) || (ms < best)) best = ms;
+        }
+
+        cout << left << setw(28) << name << right << fixed << setprecision(1) << best << " ms, " << setprecision(2) << (static_cast<double>(allocs) / static_cast<double>(nLines)) << " allocs/line" << endl;
+
+        if (best >= 100) b.fail(name, "takes 100 ms or more");
+        if (allocs >= (nLines / 2)) b.fail(name, "allocates per line");
+
+        fs::remove_all(dir);
+    }
+
+    // arguments
+    if (b.enabled("ArgList::parse"))
+    {
+        size_t nBytes;
+        const vector<string> argStrs = genArgStrings(size / 16, nBytes);
+
+        b.run("ArgList::parse", nBytes, 3, [&]()
+            {
+                for (size_t i = 0; i < argStrs.size(); ++i) ArgList::parse(argStrs[i].c_str());
+            });
+    }
+
+    return ((b.failed() == 0) ? 0 : 1);
+}
@@ -0,0 +1,273 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+// Compares the throughput of convertLineEnding() with the per character implementation of
+// potoroo v0.2.0 (kept below as reference). The files are converted twice before measuring,
+// so the results are taken on a warm page cache. The file to file conversions are bound by the
+// write speed of the file system, the in memory column shows the speed of the engine itself.
+// The generated inputs contain a "\r\r\n" at every 128 KiB block boundary of the conversion,
+// the outputs are checked against a plain string replacement.
+//
+// usage: bench_lineEnding [SIZE_MIB [DIR]]
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "middleware/scanner.h"
+#include "middleware/util.h"
+
+namespace fs = std::filesystem;
+
+using namespace std;
+
+namespace
+{
+    // convertLineEnding() of v0.2.0
+    int convertLineEnding_ref(const fs::path& inf, lineEnding infLineEnding, const fs::path& outf, lineEnding outfLineEnding)
+    {
+        int result = 0;
+
+        ifstream ifs;
+        ofstream ofs;
+
+        ofs.exceptions(ios::failbit | ios::badbit | ios::eofbit);
+
+        ifs.open(inf, ios::in | ios::binary);
+        ofs.open(outf, ios::out | ios::binary);
+
+        bool proc = true;
+
+        if (infLineEnding == lineEnding::CRLF)
+        {
+            char c[2] = { 0, 0 };
+
+            while (proc)
+            {
+                c[0] = static_cast<char>(ifs.get());
+
+                if (ifs.good())
+                {
+                    if (c[0] == static_cast<char>(0x0D))
+                    {
+                        c[1] = static_cast<char>(ifs.get());
+
+                        if (ifs.good())
+                        {
+                            if (c[1] == static_cast<char>(0x0A))
+                            {
+                                if (outfLineEnding == lineEnding::LF) ofs.put(0x0A);
+                                else if (outfLineEnding == lineEnding::CR) ofs.put(0x0D);
+                                else { ofs.put(0x0D); ofs.put(0x0A); }
+                            }
+                            else
+                            {
+                                ofs.put(c[0]);
+                                ofs.put(c[1]);
+                            }
+                        }
+                        else
+                        {
+                            if (ifs.eof()) ofs.put(c[0]);
+                            else result = 3;
+
+                            proc = false;
+                        }
+                    }
+                    else ofs.put(c[0]);
+                }
+                else proc = false;
+            }
+        }
+        else
+        {
+            const char inNL = ((infLineEnding == lineEnding::LF) ? 0x0A : 0x0D);
+
+            while (proc)
+            {
+                char c = static_cast<char>(ifs.get());
+
+                if (ifs.good())
+                {
+                    if (c == inNL)
+                    {
+                        if (outfLineEnding == lineEnding::LF) ofs.put(0x0A);
+                        else if (outfLineEnding == lineEnding::CR) ofs.put(0x0D);
+                        else { ofs.put(0x0D); ofs.put(0x0A); }
+                    }
+                    else ofs.put(c);
+                }
+                else proc = false;
+            }
+        }
+
+        ifs.close();
+        ofs.close();
+
+        return result;
+    }
+
+    const char* leStr(lineEnding le)
+    {
+        if (le == lineEnding::CR) return "CR";
+        if (le == lineEnding::CRLF) return "CRLF";
+        return "LF";
+    }
+
+    const char* leNL(lineEnding le)
+    {
+        if (le == lineEnding::CR) return "\r";
+        if (le == lineEnding::CRLF) return "\r\n";
+        return "\n";
+    }
+
+    //! @brief Puts a "\r\r\n" at every block boundary of convertLineEnding(), the last CR of a block is not part of a CR LF pair
+    void addBoundaryCRs(string& data)
+    {
+        const size_t blockSize = 128 * 1024;
+        for (size_t i = blockSize - 1; (i + 3) <= data.size(); i += blockSize) data.replace(i, 3, "\r\r\n");
+    }
+
+    string convertPlain(const string& data, lineEnding inLE, lineEnding outLE)
+    {
+        const string inNL = leNL(inLE);
+        const string outNL = leNL(outLE);
+
+        string r;
+        r.reserve(2 * data.size());
+
+        size_t i = 0;
+        while (i < data.size())
+        {
+            if (data.compare(i, inNL.length(), inNL) == 0)
+            {
+                r += outNL;
+                i += inNL.length();
+            }
+            else r += data[i++];
+        }
+
+        return r;
+    }
+
+    string readFile(const fs::path& file)
+    {
+        ifstream ifs(file, ios::in | ios::binary);
+        return string((istreambuf_iterator<char>(ifs)), istreambuf_iterator<char>());
+    }
+
+    //! @brief Writes source code like text, line lengths are 0..120
+    void generate(const fs::path& file, size_t size, lineEnding le)
+    {
+        const char* const nl = ((le == lineEnding::LF) ? "\n" : ((le == lineEnding::CR) ? "\r" : "\r\n"));
+        const string chars = "abcdefghijklmnopqrstuvwxyz    ;(){}=+-*/\t";
+
+        mt19937 rng(42);
+        string data;
+        data.reserve(size + 128);
+
+        while (data.size() < size)
+        {
+            const size_t len = rng() % 121;
+            for (size_t i = 0; i < len; ++i) data += chars[rng() % chars.length()];
+            data += nl;
+        }
+
+        addBoundaryCRs(data);
+
+        ofstream ofs(file, ios::out | ios::binary);
+        ofs.write(data.data(), data.size());
+    }
+
+    template <class F>
+    double measure(F f, size_t nBytes, int nRuns)
+    {
+        f();
+        f();
+
+        double best = 0;
+
+        for (int i = 0; i < nRuns; ++i)
+        {
+            const auto t0 = chrono::steady_clock::now();
+            f();
+            const auto t1 = chrono::steady_clock::now();
+
+            const double s = chrono::duration<double>(t1 - t0).count();
+            const double mbps = ((s > 0) ? (static_cast<double>(nBytes) / s / 1e6) : 0);
+            if (mbps > best) best = mbps;
+        }
+
+        return best;
+    }
+}
+
+
+
+int main(int argc, char** argv)
+{
+    size_t sizeMiB = 64;
+    fs::path dir = fs::temp_directory_path() / "potoroo_bench_lineEnding";
+
+    if (argc > 1) sizeMiB = stoul(argv[1]);
+    if (argc > 2) dir = argv[2];
+
+    fs::create_directories(dir);
+
+    const lineEnding cases[][2] = {
+        { lineEnding::CRLF, lineEnding::LF },
+        { lineEnding::LF, lineEnding::CRLF },
+        { lineEnding::LF, lineEnding::CR },
+        { lineEnding::CR, lineEnding::LF },
+    };
+
+    cout << "convertLineEnding, " << sizeMiB << " MiB, scanner " << scannerIsaName(scannerGetIsa()) << endl;
+    cout << left << setw(14) << "conversion" << right << setw(14) << "v0.2.0 MB/s" << setw(14) << "MB/s" << setw(10) << "speedup" << setw(18) << "in memory MB/s" << endl;
+
+    int r = 0;
+
+    for (const auto& c : cases)
+    {
+        const lineEnding inLE = c[0];
+        const lineEnding outLE = c[1];
+
+        const fs::path inf = dir / (string("in_") + leStr(inLE));
+        const fs::path outRef = dir / "out_ref";
+        const fs::path outNew = dir / "out_new";
+
+        if (!fs::exists(inf)) generate(inf, sizeMiB * 1024 * 1024, inLE);
+        const size_t nBytes = static_cast<size_t>(fs::file_size(inf));
+
+        const double ref = measure([&]() { convertLineEnding_ref(inf, inLE, outRef, outLE); }, nBytes, 1);
+        const double cur = measure([&]() { convertLineEnding(inf, inLE, outNew, outLE); }, nBytes, 5);
+
+        vector<char> inData(nBytes);
+        vector<char> outData;
+        ifstream(inf, ios::in | ios::binary).read(inData.data(), nBytes);
+        const double mem = measure([&]() { convertLineEnding(inData.data(), inData.size(), inLE, outData, outLE); }, nBytes, 5);
+
+        const string expected = convertPlain(readFile(inf), inLE, outLE);
+        const bool eq = ((readFile(outNew) == expected) && (string(outData.data(), outData.size()) == expected));
+        if (!eq) r = 1;
+
+        cout << left << setw(14) << (string(leStr(inLE)) + " -> " + leStr(outLE)) << right << fixed << setprecision(0)
+            << setw(14) << ref << setw(14) << cur << setw(9) << setprecision(1) << (cur / ref) << "x"
+            << setw(18) << setprecision(0) << mem
+            << (eq ? "" : "  OUTPUT DIFFERS") << endl;
+    }
+
+    fs::remove_all(dir);
+
+    return r;
+}
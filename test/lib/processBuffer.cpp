@@ -0,0 +1,167 @@
+/*!
+
+\author         Oliver Blaser
+\date           17.10.2026
+\copyright      GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+
+*/
+
+// Behaviour of processBuffer(), the public interface of libpotoroo. Each case processes a
+// buffer with an in memory include resolver and checks the output and the diagnostics.
+//
+// usage: test_processBuffer
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "libpotoroo.h"
+
+using namespace std;
+using namespace potoroo;
+
+namespace
+{
+    //! @brief Result and output of one processBuffer() call
+    struct Run
+    {
+        BufferResult result;
+        string output;
+        vector<string> resolved; // paths passed to the resolver, in order of the calls
+    };
+
+    Run run(const string& input, const string& name, const map<string, string>& files, bool warningAsError = false)
+    {
+        Run r;
+
+        BufferOptions options;
+        options.warningAsError = warningAsError;
+
+        const IncludeResolver resolver = [&files, &r](const string& path, string& content)
+        {
+            r.resolved.push_back(path);
+
+            const auto it = files.find(path);
+            if (it == files.end()) return false;
+
+            content = it->second;
+            return true;
+        };
+
+        const OutputSink sink = [&r](const char* data, size_t size) { r.output.append(data, size); };
+
+        r.result = processBuffer(input, name, options, resolver, sink);
+
+        return r;
+    }
+
+    bool hasDiagnostic(const Run& r, Diagnostic::Severity severity, const string& file, size_t line, const string& text)
+    {
+        for (const Diagnostic& d : r.result.diagnostics)
+        {
+            if ((d.severity == severity) && (d.file == file) && (d.line == line) && (d.message.find(text) != string::npos)) return true;
+        }
+
+        return false;
+    }
+
+    class Tests
+    {
+    public:
+        Tests() : nFailed(0) {}
+
+        void check(const string& name, bool cond, const string& what)
+        {
+            if (!cond)
+            {
+                cout << name << ": " << what << endl;
+                ++nFailed;
+            }
+        }
+
+        int failed() const
+        {
+            return nFailed;
+        }
+
+    private:
+        int nFailed;
+    };
+}
+
+
+
+int main()
+{
+    Tests t;
+
+    {
+        const string name = "directives";
+        const Run r = run("a\n//#p ins b\n//#p rm\nc\n//#p endrm\nd\n", "main.js", {});
+
+        t.check(name, (r.result.err == 0) && (r.result.warn == 0), "unexpected diagnostics");
+        t.check(name, r.output == "a\nb\nd\n", "wrong output \"" + r.output + "\"");
+    }
+
+    {
+        const string name = "resolver miss";
+        const Run r = run("a\n//#p include \"missing.js\"\nb\n", "main.js", {});
+
+        t.check(name, r.result.err == 1, "expected 1 error, got " + to_string(r.result.err));
+        t.check(name, hasDiagnostic(r, Diagnostic::error, "main.js", 2, "does not exist"), "missing error at main.js:2");
+        t.check(name, (r.resolved.size() == 1) && (r.resolved[0] == "missing.js"), "resolver not called with \"missing.js\"");
+        t.check(name, r.output.empty(), "output written despite the error");
+    }
+
+    {
+        const string name = "nested includes";
+        const map<string, string> files = {
+            { "inc/a.js", "a1\n//#p include \"b.js\"\na2\n" },
+            { "inc/b.js", "b1\n//#p include \"../c.js\"\n" },
+            { "c.js", "c1\n" },
+        };
+        const Run r = run("m1\n//#p include \"inc/a.js\"\nm2\n", "main.js", files);
+
+        t.check(name, (r.result.err == 0) && (r.result.warn == 0), "unexpected diagnostics");
+        t.check(name, r.output == "m1\na1\nb1\nc1\na2\nm2\n", "wrong output \"" + r.output + "\"");
+        t.check(name, r.resolved == vector<string>({ "inc/a.js", "inc/b.js", "c.js" }), "include paths not resolved relative to the including file");
+    }
+
+    {
+        const string name = "nested include miss";
+        const map<string, string> files = { { "inc/a.js", "a1\n\n//#p include \"b.js\"\n" } };
+        const Run r = run("//#p include \"inc/a.js\"\n", "main.js", files);
+
+        t.check(name, r.result.err > 0, "no error");
+        t.check(name, hasDiagnostic(r, Diagnostic::error, "a.js", 3, "does not exist"), "missing error at a.js:3");
+    }
+
+    {
+        const string name = "Werror";
+        const map<string, string> files = { { "empty.js", "" } };
+        const string input = "a\n//#p include \"empty.js\"\nb\n";
+
+        const Run rw = run(input, "main.js", files);
+        t.check(name, (rw.result.err == 0) && (rw.result.warn == 1), "expected 0 errors and 1 warning without -Werror");
+        t.check(name, hasDiagnostic(rw, Diagnostic::warning, "main.js", 2, "empty include file"), "missing warning at main.js:2");
+        t.check(name, rw.output == "a\nb\n", "wrong output \"" + rw.output + "\"");
+
+        const Run re = run(input, "main.js", files, true);
+        t.check(name, (re.result.err == 1) && (re.result.warn == 1), "expected 1 error and 1 warning with -Werror");
+        t.check(name, re.output.empty(), "output written despite -Werror");
+    }
+
+    {
+        const string name = "CRLF";
+        const map<string, string> files = { { "inc.js", "i1\r\ni2\r\n" } };
+        const Run r = run("a\r\n//#p ins b\r\n//#p include \"inc.js\"\r\nc\r\n", "main.js", files);
+
+        t.check(name, (r.result.err == 0) && (r.result.warn == 0), "unexpected diagnostics");
+        t.check(name, r.output == "a\r\nb\r\ni1\r\ni2\r\nc\r\n", "wrong output");
+    }
+
+    if (t.failed() == 0) cout << "all tests passed" << endl;
+
+    return ((t.failed() == 0) ? 0 : 1);
+}
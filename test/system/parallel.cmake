@@ -0,0 +1,66 @@
+#
+# author        Oliver Blaser
+# date          17.10.2026
+# copyright     GNU GPLv3 - Copyright (c) 2022 Oliver Blaser
+#
+
+# Runs the jobfile of a system test sequentially and then several times in parallel. The output
+# trees and the printed results of the parallel runs have to be the same as the sequential one.
+# The processor test has jobs writing the same output file and jobs removing their output.
+#
+# usage: cmake -DPOTOROO=FILE -DTEST_DIR=DIR -DWORK_DIR=DIR [-DJOBS=N] [-DRUNS=N] -P parallel.cmake
+
+cmake_minimum_required(VERSION 3.13)
+
+if(NOT DEFINED JOBS)
+    set(JOBS 8)
+endif()
+
+if(NOT DEFINED RUNS)
+    set(RUNS 20)
+endif()
+
+# runs the jobfile in a fresh copy of the test directory, RESULT is the printed text and a list of the files with their hashes
+function(run_test NTHREADS RESULT)
+    file(REMOVE_RECURSE ${WORK_DIR})
+    file(MAKE_DIRECTORY ${WORK_DIR})
+    file(COPY ${TEST_DIR}/ DESTINATION ${WORK_DIR})
+    file(REMOVE_RECURSE ${WORK_DIR}/000_deploy)
+
+    execute_process(
+        COMMAND ${POTOROO} -jf potorooJobs -j ${NTHREADS}
+        WORKING_DIRECTORY ${WORK_DIR}
+        OUTPUT_VARIABLE output
+        ERROR_VARIABLE output
+        RESULT_VARIABLE rc
+    )
+
+    file(GLOB_RECURSE entries RELATIVE ${WORK_DIR} LIST_DIRECTORIES true ${WORK_DIR}/*)
+    list(SORT entries)
+
+    set(tree "")
+    foreach(entry ${entries})
+        if(IS_DIRECTORY ${WORK_DIR}/${entry})
+            string(APPEND tree "${entry}/\n")
+        else()
+            file(SHA256 ${WORK_DIR}/${entry} hash)
+            string(APPEND tree "${entry} ${hash}\n")
+        endif()
+    endforeach()
+
+    set(${RESULT} "rc=${rc}\n${output}\n${tree}" PARENT_SCOPE)
+endfunction()
+
+run_test(1 expected)
+
+foreach(i RANGE 1 ${RUNS})
+    run_test(${JOBS} actual)
+
+    if(NOT actual STREQUAL expected)
+        message(FATAL_ERROR "run ${i} with -j ${JOBS} differs from -j 1\n--- expected\n${expected}\n--- actual\n${actual}")
+    endif()
+endforeach()
+
+file(REMOVE_RECURSE ${WORK_DIR})
+
+message(STATUS "${RUNS} runs with -j ${JOBS} match -j 1")